@@ -4,7 +4,7 @@
  * @brief C++ source for a multithreaded solution to compute the sparsity of a
  * matrix. The sparsity of a matrix is defined as the number of zero entries of
  * a matrix.
- * Techniques implemented: Chunk, Mixed, Dynamic, Block.
+ * Techniques implemented: Chunk, Mixed, Dynamic, Block, Steal.
  * @date 2024-08-08
  */
 
@@ -17,124 +17,2413 @@
 #include <chrono>
 #include <cstring>
 #include <cmath>
+#include <algorithm>
+#include <span>
+#include <memory>
+#include <random>
+#include <limits>
+#include <climits>
+#include <charconv>
+#include <fstream>
+#include <immintrin.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <linux/perf_event.h>
 
 // Classes and structs
 
+/**
+ * @brief Hardware counters of a thread. Each counter is scaled up for the time
+ * it was not scheduled on the PMU, and is marked invalid if the kernel does not
+ * expose it.
+ */
+struct PerfCounts {
+    /// @brief Counters recorded, in the order of NAMES
+    enum Event { CYCLES, INSTRUCTIONS, LLC_MISSES, L1D_MISSES, NODE_MISSES, NUM };
+    /// @brief Names of the counters in the JSON output
+    static constexpr const char *NAMES[NUM] = {"cycles", "instructions", "llc_misses", "l1d_misses", "node_misses"};
+
+    uint64_t value[NUM] = {};   /// Value of each counter
+    bool valid[NUM] = {};       /// Whether each counter was read
+
+    /**
+     * @brief Add the counters of another thread.
+     * @param o Counters to add.
+     */
+    void add(const PerfCounts &o) {
+        for (int e = 0; e < NUM; e++) value[e] += o.value[e], valid[e] |= o.valid[e];
+    }
+};
+
 /**
  * @brief Information contained by a thread.
  */
-struct ThreadInfo {
-    uint64_t id;    /// Thread id
-    int res;        /// Result of thread computation
-};
+struct ThreadInfo {
+    uint64_t id;        /// Thread id
+    uint64_t res;       /// Result of thread computation
+    uint64_t parsed;    /// Number of elements decoded, for pipelined mode only
+    uint64_t steals;    /// Number of successful steals, for steal technique only
+    uint64_t bytes;     /// Bytes of the matrix read, for pinned threads only
+    uint64_t ns;        /// Time spent in the runner, for pinned threads only
+    int cpu;            /// CPU the thread is pinned to, or -1
+    PerfCounts perf{};  /// Hardware counters of the runner, for perf mode only
+};
+
+/**
+ * @brief Scoped hardware counters of the calling thread, read through
+ * perf_event_open(2). The counts are added to `out` when the scope ends.
+ * Nothing is counted unless perf mode is on, and counters the kernel does not
+ * expose are skipped; the reason for a failure is kept in `error`. L1D read
+ * misses stand in for the cache lines pulled in from other caches, and NUMA
+ * node misses for the reads served by remote memory.
+ */
+class PerfScope {
+    int fd[PerfCounts::NUM];    /// Counter file descriptors
+    PerfCounts &out;            /// Where to add the counts
+public:
+    static inline bool enabled = false;         /// Whether perf mode is on
+    static inline std::atomic<int> error = 0;   /// errno of the last failed open
+
+    PerfScope(PerfCounts &_out) : out(_out) {
+        static const std::pair<uint32_t, uint64_t> EVENTS[PerfCounts::NUM] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8
+                                 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_NODE | PERF_COUNT_HW_CACHE_OP_READ << 8
+                                 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+        };
+        std::fill_n(fd, PerfCounts::NUM, -1);
+        if (!enabled) return;
+        for (int e = 0; e < PerfCounts::NUM; e++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = EVENTS[e].first;
+            attr.config = EVENTS[e].second;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.exclude_kernel = attr.exclude_hv = 1;
+            fd[e] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fd[e] < 0) error = errno;
+        }
+    }
+
+    ~PerfScope() {
+        for (int e = 0; e < PerfCounts::NUM; e++) {
+            // Value, time enabled and time running
+            uint64_t cnt[3];
+            if (fd[e] < 0) continue;
+            if (read(fd[e], cnt, sizeof(cnt)) == sizeof(cnt) && cnt[2]) {
+                out.value[e] += (uint64_t)((double)cnt[0] * cnt[1] / cnt[2]);
+                out.valid[e] = true;
+            }
+            close(fd[e]);
+        }
+    }
+};
+
+/**
+ * @brief Counter class, implemented using std::atomic objects.
+ */
+template<class T>
+class Counter {
+    std::atomic<T> ctr;   /// 64-bit atomic unsigned counter.
+public:
+    /**
+     * @brief Constuctor for Counter Class.
+     * @param n Starting integer for counter, defaults to 0.
+     */
+    Counter(T n = 0) : ctr(n) {}
+
+    /**
+     * @brief Method to get current value of counter.
+     * @return Current value of counter.
+     */
+    T get() { return ctr; }
+
+    /**
+     * @brief Method to get and post-increment counter atomically.
+     * @param inc Amount to increase the counter by.
+     * @return Counter value before increment.
+     */
+    T getAndIncrement(T inc = 1) { return ctr.fetch_add(inc); }
+
+    /**
+     * @brief Method to reset the counter, while no thread is using it.
+     * @param n New value of the counter.
+     */
+    void set(T n) { ctr = n; }
+};
+
+/**
+ * @brief Reusable barrier for a fixed number of threads. Waiting threads spin
+ * briefly, and then park in the kernel on a futex until the last thread
+ * arrives, so idle threads take no CPU time between phases.
+ */
+class FutexBarrier {
+    static constexpr int SPINS = 1024;  /// Checks of the phase before parking
+    const uint32_t parties;             /// Number of threads using the barrier
+    std::atomic<uint32_t> arrived = 0;  /// Threads arrived in the current phase
+    std::atomic<uint32_t> phase = 0;    /// Number of completed phases, the futex word
+
+    long futex(int op, uint32_t val) {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t *>(&phase), op, val, NULL, NULL, 0);
+    }
+
+public:
+    /**
+     * @brief Constructor for FutexBarrier.
+     * @param n Number of threads using the barrier.
+     */
+    FutexBarrier(uint32_t n) : parties(n) {}
+
+    /**
+     * @brief Wait until all threads have arrived at the barrier.
+     */
+    void arriveAndWait() {
+        uint32_t p = phase.load(std::memory_order_acquire);
+        if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == parties) {
+            // No thread can arrive for the next phase before it starts
+            arrived.store(0, std::memory_order_relaxed);
+            phase.fetch_add(1, std::memory_order_release);
+            futex(FUTEX_WAKE_PRIVATE, INT_MAX);
+            return;
+        }
+        for (int i = 0; i < SPINS; i++) {
+            if (phase.load(std::memory_order_acquire) != p) return;
+            _mm_pause();
+        }
+        while (phase.load(std::memory_order_acquire) == p) futex(FUTEX_WAIT_PRIVATE, p);
+    }
+};
+
+/**
+ * @brief Chooses how much work a thread of a dynamic technique claims from the
+ * shared counter at a time. With the fixed grain every claim is of `fixed`
+ * units. With the guided grain claims start large and shrink with the work
+ * left. With the adaptive grain claims are sized from the measured time per
+ * unit of work and the measured cost of a claim (which grows with contention
+ * on the counter), so that claiming stays a small fraction of the work; they
+ * are still capped by the guided size to keep the tail balanced.
+ */
+class ChunkSizer {
+public:
+    enum Grain { FIXED, GUIDED, ADAPTIVE };
+
+    static inline Grain grain = FIXED;          /// Grain used by all dynamic techniques
+    static constexpr double CLAIM_RATIO = 64;   /// Target ratio of work to claim time
+    static constexpr double EWMA_WEIGHT = 0.25; /// Weight of the newest measurement
+
+private:
+    using Clock = std::chrono::steady_clock;
+    uint64_t total, fixed, threads;     /// Units of work, fixed claim size, number of threads
+    uint64_t first = 0, last = 0;       /// Current claim [first, last)
+    double claimNs = 0, unitNs = 0;     /// Averaged time per claim and per unit
+    Clock::time_point claimedAt;        /// When the current claim was made
+
+    static double average(double avg, double sample) {
+        return avg ? (1 - EWMA_WEIGHT) * avg + EWMA_WEIGHT * sample : sample;
+    }
+
+public:
+    /**
+     * @brief Constructor for ChunkSizer, one per thread.
+     * @param _total Number of units of work (rows or blocks).
+     * @param _fixed Claim size for the fixed grain.
+     * @param _threads Number of threads sharing the work.
+     */
+    ChunkSizer(uint64_t _total, uint64_t _fixed, uint64_t _threads)
+        : total(_total), fixed(std::max<uint64_t>(_fixed, 1)), threads(std::max<uint64_t>(_threads, 1)) {}
+
+    /**
+     * @brief Claim the next chunk of work from the shared counter.
+     * @param ctr Shared counter of claimed units.
+     * @return First unit of the claimed chunk, which ends at `end()`.
+     */
+    uint64_t claim(Counter<uint64_t> &ctr) {
+        uint64_t inc = fixed;
+        if (grain != FIXED) {
+            // Half of a fair share of the work left
+            uint64_t left = total - std::min(total, ctr.get());
+            inc = std::max<uint64_t>(1, left / (2 * threads));
+            // The first adaptive claim is a single unit, to time it
+            if (grain == ADAPTIVE)
+                inc = unitNs ? std::clamp<uint64_t>(CLAIM_RATIO * claimNs / unitNs, 1, inc) : 1;
+        }
+        if (grain != ADAPTIVE) {
+            first = ctr.getAndIncrement(inc);
+        } else {
+            auto start = Clock::now();
+            first = ctr.getAndIncrement(inc);
+            claimedAt = Clock::now();
+            claimNs = average(claimNs, std::chrono::duration<double, std::nano>(claimedAt - start).count());
+        }
+        last = std::min(first + inc, total);
+        return first;
+    }
+
+    /**
+     * @brief End of the current claim.
+     * @return One past the last unit of the claimed chunk.
+     */
+    uint64_t end() const { return last; }
+
+    /**
+     * @brief Tell the sizer that the current claim has been worked through.
+     */
+    void done() {
+        if (grain != ADAPTIVE || first >= last) return;
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - claimedAt).count();
+        unitNs = average(unitNs, ns / (last - first));
+    }
+};
+
+/**
+ * @brief Memory mapping of a whole file, either read-only or private, where
+ * writes are copied on write and never reach the file.
+ */
+class MappedFile {
+    void *addr = MAP_FAILED;    /// Address of the mapping
+    size_t len = 0;             /// Length of the mapping in bytes
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    /**
+     * @brief Unmap the file, if mapped.
+     */
+    void close() {
+        if (addr != MAP_FAILED) munmap(addr, len);
+        addr = MAP_FAILED, len = 0;
+    }
+
+    /**
+     * @brief Map a file into memory, and start reading it ahead.
+     * @param file Path of the file.
+     * @param minLen Minimum length of the file in bytes.
+     * @param writable Whether the mapping may be written to privately.
+     * @return true on success, false (with errno set) on failure.
+     */
+    bool open(const char *file, size_t minLen = 1, bool writable = false) {
+        int fd = ::open(file, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) < 0) {
+            ::close(fd);
+            return false;
+        }
+        if ((size_t)st.st_size < std::max<size_t>(minLen, 1)) {
+            ::close(fd);
+            errno = EINVAL;
+            return false;
+        }
+        len = st.st_size;
+        addr = mmap(NULL, len, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping keeps its own reference to the file
+        ::close(fd);
+        if (addr == MAP_FAILED) return false;
+        madvise(addr, len, MADV_WILLNEED);
+        return true;
+    }
+
+    /**
+     * @brief Exchange the mappings of two files.
+     * @param other Other mapped file.
+     */
+    void swap(MappedFile &other) {
+        std::swap(addr, other.addr);
+        std::swap(len, other.len);
+    }
+
+    /**
+     * @brief First byte of the mapping.
+     */
+    const char *data() const { return (const char *)addr; }
+
+    /**
+     * @brief Length of the mapping in bytes.
+     */
+    size_t size() const { return len; }
+};
+
+/**
+ * @brief CPUs of each NUMA node that the process is allowed to run on, read
+ * from sysfs. Threads are pinned to these CPUs by a policy: compact fills the
+ * CPUs of a node before moving on to the next node, while scatter deals the
+ * threads out to the nodes in turn.
+ */
+class Topology {
+public:
+    enum Policy { NONE, COMPACT, SCATTER };
+
+private:
+    std::vector<int> ids;                   /// Number of each node in sysfs
+    std::vector<std::vector<int>> cpus;     /// Allowed CPUs of each node
+
+    /**
+     * @brief Parse a sysfs CPU list such as "0-3,8,10-11".
+     */
+    static std::vector<int> parseList(const std::string &list) {
+        std::vector<int> res;
+        const char *p = list.data(), *end = p + list.size();
+        while (p < end) {
+            int lo, hi;
+            auto [q, ec] = std::from_chars(p, end, lo);
+            if (ec != std::errc()) break;
+            hi = lo;
+            if (q < end && *q == '-') q = std::from_chars(q + 1, end, hi).ptr;
+            for (int c = lo; c <= hi; c++) res.push_back(c);
+            p = q + 1;
+        }
+        return res;
+    }
+
+public:
+    /**
+     * @brief Read the topology. Without NUMA information all allowed CPUs are
+     * treated as a single node 0.
+     */
+    void load() {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0)
+            for (int c = 0; c < (int)std::thread::hardware_concurrency(); c++) CPU_SET(c, &allowed);
+        ids.clear(), cpus.clear();
+        const char *root = "/sys/devices/system/node";
+        if (DIR *dir = opendir(root)) {
+            std::vector<int> nodes;
+            while (dirent *e = readdir(dir)) {
+                int id;
+                if (!std::strncmp(e->d_name, "node", 4) && sscanf(e->d_name + 4, "%d", &id) == 1)
+                    nodes.push_back(id);
+            }
+            closedir(dir);
+            std::sort(nodes.begin(), nodes.end());
+            for (int id : nodes) {
+                std::ifstream in(std::string(root) + "/node" + std::to_string(id) + "/cpulist");
+                std::string list;
+                std::getline(in, list);
+                std::vector<int> nodeCpus;
+                for (int c : parseList(list))
+                    if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed)) nodeCpus.push_back(c);
+                if (!nodeCpus.empty()) ids.push_back(id), cpus.push_back(nodeCpus);
+            }
+        }
+        if (cpus.empty()) {
+            ids = {0}, cpus = {{}};
+            for (int c = 0; c < CPU_SETSIZE; c++)
+                if (CPU_ISSET(c, &allowed)) cpus[0].push_back(c);
+        }
+    }
+
+    /**
+     * @brief CPU that a thread is pinned to.
+     * @param id Thread id.
+     * @param policy Pinning policy, other than NONE.
+     * @return CPU number.
+     */
+    int cpuFor(uint64_t id, Policy policy) const {
+        if (policy == SCATTER) {
+            const std::vector<int> &c = cpus[id % cpus.size()];
+            return c[id / cpus.size() % c.size()];
+        }
+        uint64_t total = 0;
+        for (auto &c : cpus) total += c.size();
+        id %= total;
+        for (auto &c : cpus) {
+            if (id < c.size()) return c[id];
+            id -= c.size();
+        }
+        return cpus[0][0];
+    }
+
+    /**
+     * @brief Number of the node holding a CPU.
+     * @param cpu CPU number.
+     * @return Node number in sysfs, or -1 if the CPU is not allowed.
+     */
+    int nodeOf(int cpu) const {
+        for (uint64_t n = 0; n < cpus.size(); n++)
+            if (std::find(cpus[n].begin(), cpus[n].end(), cpu) != cpus[n].end()) return ids[n];
+        return -1;
+    }
+};
+
+/**
+ * @brief Element types supported by the matrix. The values are stored in the
+ * header of binary matrix files, so they must never be renumbered.
+ */
+enum ElemType : uint64_t { INT32 = 0, INT8 = 1, INT16 = 2, FLOAT = 3, DOUBLE = 4 };
+
+/// @brief Element type tag of each supported C++ type
+template<class T> constexpr ElemType ELEM_TYPE = INT32;
+template<> constexpr ElemType ELEM_TYPE<int8_t> = INT8;
+template<> constexpr ElemType ELEM_TYPE<int16_t> = INT16;
+template<> constexpr ElemType ELEM_TYPE<float> = FLOAT;
+template<> constexpr ElemType ELEM_TYPE<double> = DOUBLE;
+
+/**
+ * @brief Header of the binary matrix format. It carries the same parameters as
+ * the first line of the text input, and is padded to 64 bytes. The row-major
+ * matrix following it has every row padded to `stride` elements, so that each
+ * row starts on a cache line boundary.
+ */
+struct MatrixHeader {
+    static constexpr char MAGIC[8] = {'S', 'P', 'M', 'A', 'T', 'v', '2', '\0'};
+
+    char magic[8];      /// Magic bytes, always equal to MAGIC
+    uint64_t N;         /// Number of rows (and columns) of the matrix
+    uint64_t S;         /// Sparsity (in percent) of the matrix
+    uint64_t K;         /// Number of threads
+    uint64_t rowInc;    /// Row increment for dynamic techniques
+    uint64_t stride;    /// Number of elements between consecutive rows
+    ElemType type;      /// Type of the elements
+    char pad[8];        /// Padding up to 64 bytes
+};
+static_assert(sizeof(MatrixHeader) == 64, "MatrixHeader must span one cache line");
+
+/**
+ * @brief Read the header of a binary matrix file.
+ * @param file Path of the binary matrix file.
+ * @param hdr Populated with the header of the file.
+ * @return true on success, false (with errno set) on failure.
+ */
+bool readHeader(const char *file, MatrixHeader &hdr) {
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = pread(fd, &hdr, sizeof(hdr), 0) == sizeof(hdr);
+    close(fd);
+    if (ok && std::memcmp(hdr.magic, MatrixHeader::MAGIC, sizeof(hdr.magic))) ok = false, errno = EINVAL;
+    return ok;
+}
+
+/**
+ * @brief Square matrix of elements of type T stored in a single row-major
+ * buffer whose rows are padded to a multiple of ROW_ALIGN bytes. The elements
+ * either live in memory owned by the matrix (text input) or in the private
+ * pages of a memory-mapped binary matrix file, which updates never write back.
+ */
+template<class T>
+class Matrix {
+    uint64_t n = 0;             /// Number of rows (and columns)
+    uint64_t stride = 0;        /// Number of elements between consecutive rows
+    T *storage = nullptr;       /// Owned storage, unused when mapped
+    T *placed = nullptr;        /// Storage allocated by beginPlacement, if any
+    size_t placedLen = 0;       /// Length of the placed storage in bytes
+    const T *base = nullptr;    /// First element of the matrix
+    MappedFile file;            /// Mapping of the binary matrix file, if any
+public:
+    static constexpr uint64_t ROW_ALIGN = 64;   /// Alignment of each row in bytes
+
+    /**
+     * @brief Number of elements in a row padded to ROW_ALIGN bytes.
+     * @param n Number of elements in the row.
+     */
+    static constexpr uint64_t paddedStride(uint64_t n) {
+        constexpr uint64_t perLine = ROW_ALIGN / sizeof(T);
+        return (n + perLine - 1) / perLine * perLine;
+    }
+
+    Matrix() = default;
+    Matrix(const Matrix&) = delete;
+    Matrix& operator=(const Matrix&) = delete;
+    ~Matrix() {
+        std::free(storage);
+        if (placed) munmap(placed, placedLen);
+    }
+
+    /**
+     * @brief Allocate owned, aligned storage for an n x n matrix of zeros.
+     * @param _n Number of rows (and columns).
+     */
+    void assign(uint64_t _n) {
+        n = _n;
+        stride = paddedStride(n);
+        size_t bytes = std::max<size_t>(n * stride * sizeof(T), ROW_ALIGN);
+        std::free(storage);
+        storage = (T *)std::aligned_alloc(ROW_ALIGN, bytes);
+        if (!storage) throw std::bad_alloc();
+        std::memset(storage, 0, bytes);
+        base = storage;
+    }
+
+    /**
+     * @brief Map a binary matrix file into memory. No element is copied or
+     * parsed; the runners read the mapped pages directly.
+     * @param file Path of the binary matrix file.
+     * @param hdr Populated with the header of the file.
+     * @return true on success, false (with errno set) on failure.
+     */
+    bool map(const char *path, MatrixHeader &hdr) {
+        // The current matrix is kept if the new one cannot be mapped
+        MappedFile next;
+        if (!next.open(path, sizeof(MatrixHeader), true)) return false;
+        std::memcpy(&hdr, next.data(), sizeof(MatrixHeader));
+        if (std::memcmp(hdr.magic, MatrixHeader::MAGIC, sizeof(hdr.magic))
+            || hdr.type != ELEM_TYPE<T> || hdr.stride != paddedStride(hdr.N)
+            || next.size() != sizeof(MatrixHeader) + hdr.N * hdr.stride * sizeof(T)) {
+            errno = EINVAL;
+            return false;
+        }
+        file.swap(next);
+        std::free(storage);
+        storage = NULL;
+        if (placed) munmap(placed, placedLen);
+        placed = NULL;
+        n = hdr.N;
+        stride = hdr.stride;
+        base = (const T *)(file.data() + sizeof(MatrixHeader));
+        return true;
+    }
+
+    /**
+     * @brief Allocate fresh storage for the matrix without touching it. Each
+     * page of it is backed by memory on the NUMA node of the thread that
+     * first writes to it, so every row should be copied in by placeRow() on
+     * the thread that counts it. The matrix is read from its current storage
+     * until endPlacement().
+     */
+    void beginPlacement() {
+        placedLen = std::max<size_t>(n * stride * sizeof(T), ROW_ALIGN);
+        void *p = mmap(NULL, placedLen, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) throw std::bad_alloc();
+        placed = (T *)p;
+    }
+
+    /**
+     * @brief Copy a row, padding included, into the placed storage.
+     * @param i Row index.
+     */
+    void placeRow(uint64_t i) { std::memcpy(placed + i * stride, base + i * stride, stride * sizeof(T)); }
+
+    /**
+     * @brief Switch over to the placed storage, and release the previous one.
+     */
+    void endPlacement() {
+        std::free(storage);
+        storage = NULL;
+        file.close();
+        base = placed;
+    }
+
+    /**
+     * @brief Mutable pointer to a row, for filling it in or updating it.
+     * @param i Row index.
+     * @return Pointer to the first element of row i.
+     */
+    T *row(uint64_t i) { return const_cast<T *>(base) + i * stride; }
+
+    /**
+     * @brief Access a row of the matrix.
+     * @param i Row index.
+     * @return View over the N elements of row i.
+     */
+    std::span<const T> operator[](uint64_t i) const { return {base + i * stride, n}; }
+};
+
+/**
+ * @brief Square matrix in compressed sparse row form. Only the stored entries
+ * of each row are kept, sorted by column, and every other element is zero.
+ * Stored entries may be zero themselves.
+ */
+template<class T>
+class CsrMatrix {
+    uint64_t n = 0;                     /// Number of rows (and columns)
+    std::vector<uint64_t> rowPtr;       /// Entries of row i are [rowPtr[i], rowPtr[i + 1])
+    std::vector<uint32_t> colIdx;       /// Column of each entry
+    std::vector<T> vals;                /// Value of each entry
+public:
+    /**
+     * @brief Take over the entries of a matrix, sorting each row by column.
+     * @param _n Number of rows (and columns).
+     * @param _rowPtr Start of the entries of each row, and the end of the last row.
+     * @param _colIdx Column of each entry.
+     * @param _vals Value of each entry.
+     * @return true on success, false (with errno set) if the entries are not
+     * well formed or an element is stored twice.
+     */
+    bool assign(uint64_t _n, std::vector<uint64_t> &&_rowPtr, std::vector<uint32_t> &&_colIdx, std::vector<T> &&_vals) {
+        n = _n, rowPtr = std::move(_rowPtr), colIdx = std::move(_colIdx), vals = std::move(_vals);
+        errno = EINVAL;
+        if (rowPtr.size() != n + 1 || rowPtr[0] || rowPtr[n] != colIdx.size() || colIdx.size() != vals.size())
+            return false;
+        std::vector<std::pair<uint32_t, T>> entries;
+        for (uint64_t i = 0; i < n; i++) {
+            uint64_t b = rowPtr[i], e = rowPtr[i + 1];
+            if (b > e || e > colIdx.size()) return false;
+            if (std::is_sorted(colIdx.begin() + b, colIdx.begin() + e)) {
+                if (e > b && colIdx[e - 1] >= n) return false;
+            } else {
+                entries.clear();
+                for (uint64_t k = b; k < e; k++) entries.push_back({colIdx[k], vals[k]});
+                std::sort(entries.begin(), entries.end(), [](auto &x, auto &y) { return x.first < y.first; });
+                if (entries.back().first >= n) return false;
+                for (uint64_t k = b; k < e; k++) colIdx[k] = entries[k - b].first, vals[k] = entries[k - b].second;
+            }
+            if (std::adjacent_find(colIdx.begin() + b, colIdx.begin() + e) != colIdx.begin() + e) return false;
+        }
+        errno = 0;
+        return true;
+    }
+
+    /**
+     * @brief Columns of the stored entries of a row, in increasing order.
+     * @param i Row index.
+     */
+    std::span<const uint32_t> cols(uint64_t i) const { return {colIdx.data() + rowPtr[i], rowPtr[i + 1] - rowPtr[i]}; }
+
+    /**
+     * @brief Values of the stored entries of a row, in the order of cols(i).
+     * @param i Row index.
+     */
+    const T *values(uint64_t i) const { return vals.data() + rowPtr[i]; }
+};
+
+/**
+ * @brief Nonzero mask of a matrix, holding one bit per element. Each row is
+ * padded to a multiple of 64 bytes like the rows of Matrix. Counting over the
+ * mask reads 8 to 64 times less memory than counting over the elements.
+ */
+class BitMatrix {
+    uint64_t words = 0;             /// Number of 64-bit words between consecutive rows
+    std::vector<uint64_t> bits;     /// Bit j of row i is set iff A[i][j] != 0
+public:
+    /**
+     * @brief Build the nonzero mask of a matrix.
+     * @param A Matrix to build the mask of.
+     * @param n Number of rows (and columns) of A.
+     */
+    template<class T>
+    void build(const Matrix<T> &A, uint64_t n) {
+        words = (n + 511) / 512 * 8;
+        bits.assign(n * words, 0);
+        for (uint64_t i = 0; i < n; i++) {
+            uint64_t *row = &bits[i * words];
+            std::span<const T> a = A[i];
+            for (uint64_t j = 0; j < n; j++) row[j >> 6] |= (uint64_t)(a[j] != 0) << (j & 63);
+        }
+    }
+
+    /**
+     * @brief Count the zeros in part of a row.
+     * @param i Row index.
+     * @param l First column of the range.
+     * @param r One past the last column of the range.
+     * @return Number of zeros in columns [l, r) of row i.
+     */
+    __attribute__((target_clones("popcnt", "default")))
+    uint64_t countZeros(uint64_t i, uint64_t l, uint64_t r) const {
+        if (l >= r) return 0;
+        const uint64_t *row = &bits[i * words];
+        uint64_t lw = l >> 6, rw = (r - 1) >> 6, ones = 0;
+        // Masks of the columns inside the range in the first and last words
+        uint64_t lmask = ~0ULL << (l & 63), rmask = ~0ULL >> (63 - ((r - 1) & 63));
+        if (lw == rw) return (r - l) - __builtin_popcountll(row[lw] & lmask & rmask);
+        ones += __builtin_popcountll(row[lw] & lmask) + __builtin_popcountll(row[rw] & rmask);
+        for (uint64_t w = lw + 1; w < rw; w++) ones += __builtin_popcountll(row[w]);
+        return (r - l) - ones;
+    }
+};
+
+/**
+ * @brief Zero counts of every row, of every block of the tiling of the block
+ * technique, and of the whole matrix, kept up to date as elements change.
+ * Every element is swapped atomically and every counter is a lock-free
+ * atomic, so any number of threads may update the matrix at once, and each
+ * update adjusts the counts by exactly the change it made.
+ */
+template<class T>
+class ZeroIndex {
+    /// @brief Counter padded to a cache line, so that updaters of different blocks never share a line
+    struct alignas(64) PaddedCount { std::atomic<int64_t> v = 0; };
+
+    Matrix<T> *mat = nullptr;                           /// Matrix being indexed, NULL until built
+    uint64_t n = 0, blocks = 0;                         /// Rows of the matrix, blocks per side
+    std::unique_ptr<std::atomic<int64_t>[]> rowZeros;   /// Zeros in each row
+    std::unique_ptr<PaddedCount[]> blockZeros;          /// Zeros in each block, row-major
+    PaddedCount totalZeros;                             /// Zeros in the matrix
+
+    /**
+     * @brief First row (or column) of a block row (or column), like blockStart.
+     */
+    uint64_t start(uint64_t b) const { return b * (n / blocks) + std::min(b, n % blocks); }
+
+    /**
+     * @brief Block row (or column) holding a row (or column), the inverse of start.
+     */
+    uint64_t blockOf(uint64_t i) const {
+        uint64_t q = n / blocks, r = n % blocks;
+        return i < r * (q + 1) ? i / (q + 1) : r + (i - r * (q + 1)) / q;
+    }
+
+    /**
+     * @brief Swap an element for a new value.
+     * @return Change in the number of zeros.
+     */
+    int64_t swap(uint64_t i, uint64_t j, T v) {
+        T old = std::atomic_ref<T>(mat->row(i)[j]).exchange(v, std::memory_order_relaxed);
+        return (int64_t)!v - !old;
+    }
+
+public:
+    /**
+     * @brief Prepare the index of a matrix, with all counts zero. The counts
+     * are then filled in by indexRunner.
+     * @param A Matrix to index.
+     * @param _n Number of rows (and columns) of A.
+     * @param _blocks Number of blocks per side.
+     */
+    void reset(Matrix<T> &A, uint64_t _n, uint64_t _blocks) {
+        mat = &A, n = _n, blocks = _blocks;
+        rowZeros = std::make_unique<std::atomic<int64_t>[]>(n);
+        blockZeros = std::make_unique<PaddedCount[]>(blocks * blocks);
+        totalZeros.v = 0;
+    }
+
+    /**
+     * @brief Forget the counts, when the matrix is replaced.
+     */
+    void clear() { mat = nullptr; }
+
+    /**
+     * @brief Whether the counts are in use.
+     */
+    bool ready() const { return mat; }
+
+    /**
+     * @brief Add zeros to the count of a row.
+     * @param i Row index.
+     * @param d Number of zeros added, negative for removed.
+     */
+    void addRow(uint64_t i, int64_t d) { rowZeros[i].fetch_add(d, std::memory_order_relaxed); }
+
+    /**
+     * @brief Add zeros to the count of a block.
+     * @param b Block index, row-major.
+     * @param d Number of zeros added, negative for removed.
+     */
+    void addBlock(uint64_t b, int64_t d) { blockZeros[b].v.fetch_add(d, std::memory_order_relaxed); }
+
+    /**
+     * @brief Add zeros to the count of the matrix.
+     * @param d Number of zeros added, negative for removed.
+     */
+    void addTotal(int64_t d) { totalZeros.v.fetch_add(d, std::memory_order_relaxed); }
+
+    /**
+     * @brief Update an element.
+     * @param i Row of the element.
+     * @param j Column of the element.
+     * @param v New value of the element.
+     */
+    void set(uint64_t i, uint64_t j, T v) {
+        if (int64_t d = swap(i, j, v)) {
+            addRow(i, d);
+            addBlock(blockOf(i) * blocks + blockOf(j), d);
+            addTotal(d);
+        }
+    }
+
+    /**
+     * @brief Overwrite a row, adjusting every count touched once.
+     * @param i Row index.
+     * @param vals New values of the n elements of the row.
+     */
+    void setRow(uint64_t i, const T *vals) {
+        uint64_t bi = blockOf(i);
+        int64_t d = 0;
+        for (uint64_t bj = 0; bj < blocks; bj++) {
+            int64_t bd = 0;
+            for (uint64_t j = start(bj); j < start(bj + 1); j++) bd += swap(i, j, vals[j]);
+            addBlock(bi * blocks + bj, bd);
+            d += bd;
+        }
+        addRow(i, d);
+        addTotal(d);
+    }
+
+    /**
+     * @brief Overwrite a block, adjusting every count touched once.
+     * @param bi Block row.
+     * @param bj Block column.
+     * @param vals New values of the elements of the block, row-major.
+     */
+    void setBlock(uint64_t bi, uint64_t bj, const T *vals) {
+        uint64_t l = start(bj), r = start(bj + 1);
+        int64_t d = 0;
+        for (uint64_t i = start(bi); i < start(bi + 1); i++) {
+            int64_t rd = 0;
+            for (uint64_t j = l; j < r; j++) rd += swap(i, j, *vals++);
+            addRow(i, rd);
+            d += rd;
+        }
+        addBlock(bi * blocks + bj, d);
+        addTotal(d);
+    }
+
+    /**
+     * @brief Zeros in the matrix.
+     */
+    uint64_t total() const { return totalZeros.v.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Zeros in a row.
+     * @param i Row index.
+     */
+    uint64_t row(uint64_t i) const { return rowZeros[i].load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Zeros in a rectangle of whole blocks.
+     * @param bi0 First block row.
+     * @param bj0 First block column.
+     * @param bi1 One past the last block row.
+     * @param bj1 One past the last block column.
+     */
+    uint64_t blockRect(uint64_t bi0, uint64_t bj0, uint64_t bi1, uint64_t bj1) const {
+        int64_t sm = 0;
+        for (uint64_t bi = bi0; bi < bi1; bi++)
+            for (uint64_t bj = bj0; bj < bj1; bj++) sm += blockZeros[bi * blocks + bj].v.load(std::memory_order_relaxed);
+        return sm;
+    }
+};
+
+/**
+ * @brief Zeros of every rectangle of a matrix that starts at its top left
+ * corner, from which the zeros of any rectangle take four lookups. Sums are
+ * 32-bit, which holds the zeros of any matrix with at most MAX_N rows.
+ */
+class PrefixIndex {
+    uint64_t n = 0;                         /// Rows (and columns) of the matrix
+    std::unique_ptr<uint32_t[]> sums;       /// Row i, column j holds the zeros of rows [0, i) and columns [0, j)
+public:
+    static constexpr uint64_t MAX_N = 65535;   /// Largest matrix indexed
+
+    /**
+     * @brief Allocate the sums for an n x n matrix, with row 0 zero.
+     * @param _n Rows (and columns) of the matrix.
+     */
+    void assign(uint64_t _n) {
+        n = _n;
+        sums.reset(new uint32_t[(n + 1) * (n + 1)]);
+        std::fill(sums.get(), sums.get() + n + 1, 0);
+    }
+
+    /**
+     * @brief Mutable row of sums, for building them.
+     * @param i Row index, up to n.
+     */
+    uint32_t *row(uint64_t i) { return sums.get() + i * (n + 1); }
+
+    /**
+     * @brief Zeros in rows [r0, r1) and columns [c0, c1).
+     */
+    uint64_t zeros(uint64_t r0, uint64_t c0, uint64_t r1, uint64_t c1) const {
+        const uint32_t *top = sums.get() + r0 * (n + 1), *bottom = sums.get() + r1 * (n + 1);
+        return bottom[c1] - bottom[c0] - top[c1] + top[c0];
+    }
+};
+
+// Zero-count kernels
+
+/**
+ * @brief Portable kernel counting the zeros in a contiguous range.
+ * @param p First element of the range.
+ * @param len Number of elements in the range.
+ * @return Number of zeros in the range.
+ */
+template<class T>
+uint64_t countZerosScalar(const T *p, uint64_t len) {
+    uint64_t res = 0;
+    for (uint64_t i = 0; i < len; i++) res += !p[i];
+    return res;
+}
+
+/*
+ * Each instruction set provides, for every element type, a `mask` function
+ * returning the zero bitmask of one vector register worth of elements. LANES is
+ * the number of elements per register and BITS the number of mask bits per
+ * element (2 for 16-bit integers, which only have byte-granular movemasks).
+ * Floating point elements are compared for ordered equality with 0.0, which
+ * matches `!u`: -0.0 counts as zero and NaN does not.
+ */
+
+template<class T> struct SSE2Ops;
+
+template<> struct SSE2Ops<int8_t> {
+    static constexpr unsigned LANES = 16, BITS = 1;
+    __attribute__((target("sse2"), always_inline)) static uint64_t mask(const int8_t *p) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+    }
+};
+
+template<> struct SSE2Ops<int16_t> {
+    static constexpr unsigned LANES = 8, BITS = 2;
+    __attribute__((target("sse2"), always_inline)) static uint64_t mask(const int16_t *p) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(v, _mm_setzero_si128()));
+    }
+};
+
+template<> struct SSE2Ops<int> {
+    static constexpr unsigned LANES = 4, BITS = 1;
+    __attribute__((target("sse2"), always_inline)) static uint64_t mask(const int *p) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        return (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, _mm_setzero_si128())));
+    }
+};
+
+template<> struct SSE2Ops<float> {
+    static constexpr unsigned LANES = 4, BITS = 1;
+    __attribute__((target("sse2"), always_inline)) static uint64_t mask(const float *p) {
+        return (uint32_t)_mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(p), _mm_setzero_ps()));
+    }
+};
+
+template<> struct SSE2Ops<double> {
+    static constexpr unsigned LANES = 2, BITS = 1;
+    __attribute__((target("sse2"), always_inline)) static uint64_t mask(const double *p) {
+        return (uint32_t)_mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(p), _mm_setzero_pd()));
+    }
+};
+
+template<class T> struct AVX2Ops;
+
+template<> struct AVX2Ops<int8_t> {
+    static constexpr unsigned LANES = 32, BITS = 1;
+    __attribute__((target("avx2"), always_inline)) static uint64_t mask(const int8_t *p) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+    }
+};
+
+template<> struct AVX2Ops<int16_t> {
+    static constexpr unsigned LANES = 16, BITS = 2;
+    __attribute__((target("avx2"), always_inline)) static uint64_t mask(const int16_t *p) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(v, _mm256_setzero_si256()));
+    }
+};
+
+template<> struct AVX2Ops<int> {
+    static constexpr unsigned LANES = 8, BITS = 1;
+    __attribute__((target("avx2"), always_inline)) static uint64_t mask(const int *p) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, _mm256_setzero_si256())));
+    }
+};
+
+template<> struct AVX2Ops<float> {
+    static constexpr unsigned LANES = 8, BITS = 1;
+    __attribute__((target("avx2"), always_inline)) static uint64_t mask(const float *p) {
+        return (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(p), _mm256_setzero_ps(), _CMP_EQ_OQ));
+    }
+};
+
+template<> struct AVX2Ops<double> {
+    static constexpr unsigned LANES = 4, BITS = 1;
+    __attribute__((target("avx2"), always_inline)) static uint64_t mask(const double *p) {
+        return (uint32_t)_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p), _mm256_setzero_pd(), _CMP_EQ_OQ));
+    }
+};
+
+template<class T> struct AVX512Ops;
+
+template<> struct AVX512Ops<int8_t> {
+    static constexpr unsigned LANES = 64, BITS = 1;
+    __attribute__((target("avx512f,avx512bw"), always_inline)) static uint64_t mask(const int8_t *p) {
+        return _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(p), _mm512_setzero_si512());
+    }
+};
+
+template<> struct AVX512Ops<int16_t> {
+    static constexpr unsigned LANES = 32, BITS = 1;
+    __attribute__((target("avx512f,avx512bw"), always_inline)) static uint64_t mask(const int16_t *p) {
+        return _mm512_cmpeq_epi16_mask(_mm512_loadu_si512(p), _mm512_setzero_si512());
+    }
+};
+
+template<> struct AVX512Ops<int> {
+    static constexpr unsigned LANES = 16, BITS = 1;
+    __attribute__((target("avx512f"), always_inline)) static uint64_t mask(const int *p) {
+        return _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(p), _mm512_setzero_si512());
+    }
+};
+
+template<> struct AVX512Ops<float> {
+    static constexpr unsigned LANES = 16, BITS = 1;
+    __attribute__((target("avx512f"), always_inline)) static uint64_t mask(const float *p) {
+        return _mm512_cmp_ps_mask(_mm512_loadu_ps(p), _mm512_setzero_ps(), _CMP_EQ_OQ);
+    }
+};
+
+template<> struct AVX512Ops<double> {
+    static constexpr unsigned LANES = 8, BITS = 1;
+    __attribute__((target("avx512f"), always_inline)) static uint64_t mask(const double *p) {
+        return _mm512_cmp_pd_mask(_mm512_loadu_pd(p), _mm512_setzero_pd(), _CMP_EQ_OQ);
+    }
+};
+
+/**
+ * @brief SSE2 kernel. The masks of consecutive registers are packed into one
+ * 64-bit word so that a single popcount covers up to 64 elements.
+ */
+template<class T>
+__attribute__((target("sse2")))
+uint64_t countZerosSSE2(const T *p, uint64_t len) {
+    using V = SSE2Ops<T>;
+    constexpr unsigned W = V::LANES * V::BITS, REGS = 64 / W;
+    uint64_t bits = 0, i = 0;
+    for (; i + REGS * V::LANES <= len; i += REGS * V::LANES) {
+        uint64_t m = 0;
+        for (unsigned r = 0; r < REGS; r++) m |= V::mask(p + i + r * V::LANES) << (r * W);
+        bits += __builtin_popcountll(m);
+    }
+    return bits / V::BITS + countZerosScalar(p + i, len - i);
+}
+
+/**
+ * @brief AVX2 kernel. The masks of consecutive registers are packed into one
+ * 64-bit word so that a single popcount covers up to 64 elements.
+ */
+template<class T>
+__attribute__((target("avx2,popcnt")))
+uint64_t countZerosAVX2(const T *p, uint64_t len) {
+    using V = AVX2Ops<T>;
+    constexpr unsigned W = V::LANES * V::BITS, REGS = 64 / W;
+    uint64_t bits = 0, i = 0;
+    for (; i + REGS * V::LANES <= len; i += REGS * V::LANES) {
+        uint64_t m = 0;
+        for (unsigned r = 0; r < REGS; r++) m |= V::mask(p + i + r * V::LANES) << (r * W);
+        bits += _mm_popcnt_u64(m);
+    }
+    return bits / V::BITS + countZerosSSE2(p + i, len - i);
+}
+
+/**
+ * @brief AVX-512 kernel. The mask registers of consecutive comparisons are
+ * packed into one 64-bit word so that a single popcount covers 64 elements.
+ */
+template<class T>
+__attribute__((target("avx512f,avx512bw,popcnt")))
+uint64_t countZerosAVX512(const T *p, uint64_t len) {
+    using V = AVX512Ops<T>;
+    constexpr unsigned W = V::LANES * V::BITS, REGS = 64 / W;
+    uint64_t bits = 0, i = 0;
+    for (; i + REGS * V::LANES <= len; i += REGS * V::LANES) {
+        uint64_t m = 0;
+        for (unsigned r = 0; r < REGS; r++) m |= V::mask(p + i + r * V::LANES) << (r * W);
+        bits += _mm_popcnt_u64(m);
+    }
+    return bits / V::BITS + countZerosAVX2(p + i, len - i);
+}
+
+/**
+ * @brief A zero-count kernel along with the CPU features it needs.
+ */
+template<class T>
+struct Kernel {
+    const char *name;                           /// Name used on the command line
+    bool (*supported)();                        /// Whether the CPU can run it
+    uint64_t (*count)(const T *, uint64_t);     /// Kernel function
+};
+
+/// @brief Available kernels for each element type, fastest first
+template<class T>
+const Kernel<T> KERNELS[] = {
+    {"avx512", [] {
+        // Byte and word comparisons need AVX-512BW
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+            && __builtin_cpu_supports("popcnt");
+    }, countZerosAVX512<T>},
+    {"avx2", [] { return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"); }, countZerosAVX2<T>},
+    {"sse2", [] { return __builtin_cpu_supports("sse2") != 0; }, countZerosSSE2<T>},
+    {"scalar", [] { return true; }, countZerosScalar<T>},
+};
+
+/**
+ * @brief Pick a zero-count kernel based on CPUID.
+ * @param name Name of the requested kernel, or "auto" for the fastest one.
+ * @return The kernel, or NULL if it is unknown or unsupported by the CPU.
+ */
+template<class T>
+const Kernel<T> *selectKernel(const std::string &name) {
+    __builtin_cpu_init();
+    for (const Kernel<T> &k : KERNELS<T>)
+        if ((name == "auto" || name == k.name) && k.supported()) return &k;
+    return NULL;
+}
+
+// Constants
+
+const char* INFILE = "inp.txt";   /// Input file
+const char* OUTFILE = "out.txt";  /// Output file
+const char* PERFFILE = "out.json"; /// Hardware counter file, for perf mode only
+const char* ANSFILE = "ans.txt";  /// Answers to batch queries
+
+// Global variables
+
+uint64_t N, S, K, rowInc, blockSize;
+template<class T> Matrix<T> A;   /// Matrix with elements of type T
+template<class T> CsrMatrix<T> C;   /// Stored entries of the matrix, for sparse input only
+template<class T> ZeroIndex<T> Z;   /// Zero counts of A, for server mode only
+BitMatrix B;                     /// Nonzero mask of the matrix, for bitmap mode only
+template<class T> uint64_t (*countZerosKernel)(const T *, uint64_t) = countZerosScalar<T>;
+Counter<uint64_t> counter(0);    /// For dynamic methods only
+Topology topology;               /// NUMA nodes and CPUs, for pinned threads only
+thread_local uint64_t bytesRead; /// Bytes of the matrix read by the calling thread
+
+/**
+ * @brief Count the zeros of a range of a row of the matrix of type T.
+ */
+template<class T>
+uint64_t countZerosDense(uint64_t i, uint64_t l, uint64_t r) {
+    bytesRead += (r - l) * sizeof(T);
+    return countZerosKernel<T>(A<T>[i].data() + l, r - l);
+}
+
+/**
+ * @brief Count the zeros of a range of a row of the sparse matrix of type T,
+ * which are the elements of the range not stored and the stored zeros.
+ */
+template<class T>
+uint64_t countZerosSparse(uint64_t i, uint64_t l, uint64_t r) {
+    std::span<const uint32_t> cols = C<T>.cols(i);
+    const uint32_t *b = cols.data(), *e = b + cols.size();
+    if (l || r < N) {
+        b = std::lower_bound(b, e, l);
+        e = std::lower_bound(b, e, r);
+    }
+    uint64_t stored = e - b;
+    bytesRead += stored * (sizeof(T) + sizeof(uint32_t));
+    return (r - l) - stored + countZerosKernel<T>(C<T>.values(i) + (b - cols.data()), stored);
+}
+
+/**
+ * @brief Count the zeros of a range of a row using the nonzero mask.
+ */
+uint64_t countZerosBitmap(uint64_t i, uint64_t l, uint64_t r) {
+    bytesRead += (r - l + 7) / 8;
+    return B.countZeros(i, l, r);
+}
+
+/// @brief Inner kernel of all runners, counting the zeros in columns [l, r) of row i
+uint64_t (*countZeros)(uint64_t i, uint64_t l, uint64_t r) = countZerosDense<int>;
+
+/**
+ * @brief First row (or column) of a block row (or column) of the block
+ * technique, which splits the N rows into numBlocks nearly equal parts.
+ * @param b Block row (or column), up to numBlocks.
+ * @param numBlocks Number of blocks per side.
+ */
+uint64_t blockStart(uint64_t b, uint64_t numBlocks) { return b * (N / numBlocks) + std::min(b, N % numBlocks); }
+
+// Thread runners
+
+/**
+ * @brief Runner function for chunk technique.
+ * @param thInfo Thread information.
+ * @return Populated result in `thInfo`.
+ */
+void chunkRunner(ThreadInfo& thInfo) {
+    // Remaining i.e., N % K rows are to be given to first N % K threads.
+    // Find starting row as id * (N / K) + min(id, N % K);
+    uint64_t l = thInfo.id * (N / K) + std::min(thInfo.id, N % K);
+    for (uint64_t i = l; i < std::min(N, l + N / K + (thInfo.id < N % K)); i++) {
+        thInfo.res += countZeros(i, 0, N);
+    }
+}
+
+/**
+ * @brief Runner function for mixed technique.
+ * @param thInfo Thread information.
+ * @return Populated result in `thInfo`.
+ */
+void mixedRunner(ThreadInfo& thInfo) {
+    for (uint64_t i = thInfo.id; i < N; i += K) {
+        thInfo.res += countZeros(i, 0, N);
+    }
+}
+
+/**
+ * @brief Runner function for dynamic technique.
+ * @param thInfo Thread information.
+ * @return Populated result in `thInfo`.
+ */
+void dynamicRunner(ThreadInfo& thInfo) {
+    ChunkSizer sizer(N, rowInc, K);
+    // Attempt to get a new row
+    while (counter.get() < N) {
+        // Acquire rows and increment
+        uint64_t r = sizer.claim(counter);
+        for (uint64_t i = r; i < sizer.end(); i++) {
+            thInfo.res += countZeros(i, 0, N);
+        }
+        sizer.done();
+    } 
+}
+
+/**
+ * @brief Runner function for dynamic block technique. We will have blocks of
+ * size blockSize. Here, we consider blockSize = sqrt(N) for a total of N blocks
+ * to make it comparable to other methods.
+ * @param thInfo Thread information.
+ * @return Populated result in `thInfo`.
+ */
+void dynamicBlockRunner(ThreadInfo& thInfo) {
+    // Compute total number of blocks, which is ceil(N / blockSize) ^ 2.
+    uint64_t numBlocks = (N + blockSize - 1) / blockSize;
+    uint64_t totalBlocks = numBlocks * numBlocks;
+    ChunkSizer sizer(totalBlocks, rowInc, K);
+    // Attempt to get a new block
+    while (counter.get() < totalBlocks) {
+        // Acquire blocks and increment
+        uint64_t b = sizer.claim(counter);
+        for (uint64_t i = b; i < sizer.end(); i++) {
+            // Compute (row, col) as (b / K, b % K);
+            uint64_t row = i / numBlocks, col = i % numBlocks;
+            // Now compute limits based on row and col, similar to the chunk case
+            uint64_t coll = blockStart(col, numBlocks), colr = blockStart(col + 1, numBlocks);
+            for (uint64_t j = blockStart(row, numBlocks); j < blockStart(row + 1, numBlocks); j++)
+                thInfo.res += countZeros(j, coll, colr);
+        }
+        sizer.done();
+    }
+}
+
+/// @brief Rectangle [rowLo, rowHi) x [colLo, colHi) counted by rectRunner
+uint64_t rowLo, rowHi, colLo, colHi;
+
+/**
+ * @brief Runner function for sub-matrix queries, splitting the rows of the
+ * rectangle into chunks like the chunk technique.
+ * @param thInfo Thread information.
+ * @return Populated result in `thInfo`.
+ */
+void rectRunner(ThreadInfo& thInfo) {
+    uint64_t rows = rowHi - rowLo;
+    uint64_t l = rowLo + thInfo.id * (rows / K) + std::min(thInfo.id, rows % K);
+    for (uint64_t i = l; i < l + rows / K + (thInfo.id < rows % K); i++) {
+        thInfo.res += countZeros(i, colLo, colHi);
+    }
+}
+
+// Pinned threads
+
+/**
+ * @brief Pin the calling thread to the CPU in `thInfo`, if any.
+ * @param thInfo Thread information, whose CPU is reset to -1 on failure.
+ */
+void pinThread(ThreadInfo& thInfo) {
+    if (thInfo.cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(thInfo.cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) thInfo.cpu = -1;
+}
+
+/**
+ * @brief Run a runner on the calling thread, and record the time it took, the
+ * bytes of the matrix it read and, in perf mode, its hardware counters.
+ * @param runner Runner function.
+ * @param thInfo Thread information.
+ */
+void measuredRunner(void (*runner)(ThreadInfo&), ThreadInfo& thInfo) {
+    bytesRead = 0;
+    PerfScope perf(thInfo.perf);
+    auto start = std::chrono::steady_clock::now();
+    runner(thInfo);
+    thInfo.ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    thInfo.bytes = bytesRead;
+}
+
+/**
+ * @brief Run a runner on the calling thread, pinned to the CPU in `thInfo`.
+ * @param runner Runner function.
+ * @param thInfo Thread information.
+ */
+void pinnedRunner(void (*runner)(ThreadInfo&), ThreadInfo& thInfo) {
+    pinThread(thInfo);
+    measuredRunner(runner, thInfo);
+}
+
+/**
+ * @brief Run a runner on a new thread for every ThreadInfo, pinned to its
+ * CPU, and join them.
+ * @param threadInfos Information of the threads, with their CPUs.
+ * @param runner Runner function.
+ */
+void runThreads(std::vector<ThreadInfo>& threadInfos, void (*runner)(ThreadInfo&)) {
+    std::vector<std::thread> threads(threadInfos.size());
+    for (uint64_t i = 0; i < threads.size(); i++) threads[i] = std::thread(pinnedRunner, runner, std::ref(threadInfos[i]));
+    for (auto& th : threads) th.join();
+}
+
+/**
+ * @brief Fixed set of K pinned worker threads running one runner after
+ * another. Between runs the workers park on a futex barrier, so repeated
+ * counts pay neither for creating and joining threads nor for idle spinning.
+ */
+class ThreadPool {
+    std::vector<ThreadInfo> &infos;         /// Information of each worker
+    std::vector<std::thread> workers;       /// Worker threads
+    FutexBarrier start, finish;             /// Barriers around every run
+    void (*job)(ThreadInfo&) = NULL;        /// Runner of the current run, NULL to stop
+
+    void work(uint64_t i) {
+        pinThread(infos[i]);
+        while (true) {
+            start.arriveAndWait();
+            if (!job) return;
+            measuredRunner(job, infos[i]);
+            finish.arriveAndWait();
+        }
+    }
+
+public:
+    /**
+     * @brief Constructor for ThreadPool, starting one worker per ThreadInfo.
+     * @param _infos Information of the workers, with their CPUs.
+     */
+    ThreadPool(std::vector<ThreadInfo> &_infos)
+        : infos(_infos), start(_infos.size() + 1), finish(_infos.size() + 1) {
+        for (uint64_t i = 0; i < infos.size(); i++) workers.emplace_back(&ThreadPool::work, this, i);
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        job = NULL;
+        start.arriveAndWait();
+        for (auto &th : workers) th.join();
+    }
+
+    /**
+     * @brief Run a runner on every worker, and wait for all of them to finish.
+     * @param runner Runner function.
+     */
+    void run(void (*runner)(ThreadInfo&)) {
+        job = runner;
+        start.arriveAndWait();
+        finish.arriveAndWait();
+    }
+};
+
+// NUMA placement
+
+/// @brief Whether placeRowsRunner places the rows of the mixed technique
+bool interleavedRows = false;
+
+/**
+ * @brief Runner function copying the rows a thread counts into the placed
+ * storage of the matrix, so that they land on the NUMA node of the thread.
+ * The dynamic techniques have no fixed rows per thread, and are placed like
+ * the chunk technique.
+ * @param thInfo Thread information.
+ */
+template<class T>
+void placeRowsRunner(ThreadInfo& thInfo) {
+    if (interleavedRows) {
+        for (uint64_t i = thInfo.id; i < N; i += K) A<T>.placeRow(i);
+        return;
+    }
+    uint64_t l = thInfo.id * (N / K) + std::min(thInfo.id, N % K);
+    for (uint64_t i = l; i < std::min(N, l + N / K + (thInfo.id < N % K)); i++) {
+        A<T>.placeRow(i);
+    }
+}
+
+/**
+ * @brief Place every row of the matrix on the NUMA node of the thread that
+ * counts it, by first touch from the pinned threads.
+ * @param threadInfos Information of the threads, with their CPUs.
+ * @param pool Pool of the threads if running, or NULL to start them.
+ */
+template<class T>
+void placeMatrix(std::vector<ThreadInfo>& threadInfos, ThreadPool *pool) {
+    A<T>.beginPlacement();
+    if (pool) pool->run(placeRowsRunner<T>);
+    else runThreads(threadInfos, placeRowsRunner<T>);
+    A<T>.endPlacement();
+}
+
+/// @brief Places the matrix of the element type in use, for NUMA mode only
+void (*placeMatrixOfType)(std::vector<ThreadInfo>&, ThreadPool *) = NULL;
+
+// Work-stealing runner
+
+/**
+ * @brief Range of rows [lo, hi) left to a thread by the steal technique. Both
+ * ends are packed into one word, so that the owner taking rows off the front
+ * and thieves taking half off the back each need a single CAS. Every range
+ * sits on its own cache line, so threads only contend when stealing.
+ */
+struct alignas(64) RowRange {
+    std::atomic<uint64_t> rows;     /// lo in the upper 32 bits, hi in the lower 32 bits
+
+    static uint64_t pack(uint64_t lo, uint64_t hi) { return lo << 32 | hi; }
+    static uint64_t lo(uint64_t r) { return r >> 32; }
+    static uint64_t hi(uint64_t r) { return r & 0xffffffff; }
+};
+
+std::vector<RowRange> ranges;    /// Range of rows of each thread, for steal technique only
+
+/**
+ * @brief Steal the back half of the largest range of rows of another thread
+ * into the (empty) range of the calling thread.
+ * @param thInfo Thread information.
+ * @return true if rows were stolen, false if no thread has rows to spare.
+ */
+bool stealRows(ThreadInfo& thInfo) {
+    while (true) {
+        // Look for the victim with the most rows left
+        uint64_t victim = K, most = 1, cur = 0;
+        for (uint64_t k = 1; k < K; k++) {
+            uint64_t v = (thInfo.id + k) % K, r = ranges[v].rows.load();
+            if (RowRange::hi(r) - RowRange::lo(r) > most)
+                victim = v, most = RowRange::hi(r) - RowRange::lo(r), cur = r;
+        }
+        // A single row left is finished off by its owner
+        if (victim == K) return false;
+        uint64_t lo = RowRange::lo(cur), hi = RowRange::hi(cur), mid = lo + (hi - lo) / 2;
+        if (ranges[victim].rows.compare_exchange_strong(cur, RowRange::pack(lo, mid))) {
+            ranges[thInfo.id].rows.store(RowRange::pack(mid, hi));
+            thInfo.steals++;
+            return true;
+        }
+        // The victim moved in the meantime, look again
+    }
+}
+
+/**
+ * @brief Runner function for steal technique. Each thread starts with the rows
+ * of the chunk technique and takes rowInc of them at a time off the front.
+ * Once its own rows run out, it steals half of the rows left to another thread.
+ * @param thInfo Thread information.
+ * @return Populated result in `thInfo`.
+ */
+void stealRunner(ThreadInfo& thInfo) {
+    RowRange &own = ranges[thInfo.id];
+    do {
+        uint64_t cur = own.rows.load(), lo, hi;
+        while ((lo = RowRange::lo(cur)) < (hi = RowRange::hi(cur))) {
+            // Take up to rowInc rows off the front
+            uint64_t r = std::min(lo + rowInc, hi);
+            if (!own.rows.compare_exchange_weak(cur, RowRange::pack(r, hi))) continue;
+            for (uint64_t i = lo; i < r; i++) thInfo.res += countZeros(i, 0, N);
+            cur = own.rows.load();
+        }
+    } while (stealRows(thInfo));
+}
+
+// Pipelined runners
+
+/*
+ * In pipelined mode the text input is mapped into memory and split into bands
+ * of whole rows. The runners decode each band and count its zeros right away,
+ * so parsing is spread over all threads and overlaps reading the file. A token
+ * is zero iff all of its digits are '0', hence no value is ever built.
+ */
+
+MappedFile text;                        /// Mapping of the text input
+const char *textBegin, *textEnd;        /// Matrix part of the text input
+uint64_t bandBytes, numBands;           /// Approximate size and number of bands
+std::atomic<bool> malformed(false);     /// Whether a band held a non-integer
+
+/**
+ * @brief Find the start of the first row of the text input at or after an
+ * offset, so that bands never split a row.
+ * @param off Byte offset into the matrix part of the text input.
+ * @return Pointer to the start of the row.
+ */
+const char *rowStart(uint64_t off) {
+    if (off == 0) return textBegin;
+    if (off >= (uint64_t)(textEnd - textBegin)) return textEnd;
+    const char *p = (const char *)memchr(textBegin + off - 1, '\n', textEnd - textBegin - off + 1);
+    return p ? p + 1 : textEnd;
+}
+
+/**
+ * @brief Decode a band of the text input and count the zeros in it.
+ * @param b Band index.
+ * @param thInfo Thread information, whose result and number of decoded
+ * elements are increased.
+ */
+void countBand(uint64_t b, ThreadInfo& thInfo) {
+    const char *p = rowStart(b * bandBytes), *e = rowStart((b + 1) * bandBytes);
+    uint64_t zeros = 0, parsed = 0;
+    bool ok = true;
+    while (p != e) {
+        if ((unsigned char)*p <= ' ') {
+            p++;
+            continue;
+        }
+        if (*p == '-' || *p == '+') p++;
+        const char *digits = p;
+        bool zero = true;
+        for (; p != e && (unsigned char)*p > ' '; p++) {
+            zero &= *p == '0';
+            ok &= (unsigned)(*p - '0') < 10;
+        }
+        ok &= p != digits;
+        zeros += zero, parsed++;
+    }
+    if (!ok) malformed = true;
+    thInfo.res += zeros;
+    thInfo.parsed += parsed;
+}
+
+/**
+ * @brief Pipelined runner function for chunk technique, with one band per
+ * thread.
+ * @param thInfo Thread information.
+ * @return Populated result in `thInfo`.
+ */
+void pipelinedChunkRunner(ThreadInfo& thInfo) {
+    countBand(thInfo.id, thInfo);
+}
+
+/**
+ * @brief Pipelined runner function for mixed technique, with bands of rowInc
+ * rows dealt round robin.
+ * @param thInfo Thread information.
+ * @return Populated result in `thInfo`.
+ */
+void pipelinedMixedRunner(ThreadInfo& thInfo) {
+    for (uint64_t b = thInfo.id; b < numBands; b += K) countBand(b, thInfo);
+}
+
+/**
+ * @brief Pipelined runner function for dynamic technique, with bands of rowInc
+ * rows handed out by the shared counter.
+ * @param thInfo Thread information.
+ * @return Populated result in `thInfo`.
+ */
+void pipelinedDynamicRunner(ThreadInfo& thInfo) {
+    while (counter.get() < numBands) {
+        uint64_t b = counter.getAndIncrement();
+        if (b < numBands) countBand(b, thInfo);
+    }
+}
+
+/**
+ * @brief Map the text input, read its parameters and split it into bands.
+ * @param perThread Whether to make one band per thread (chunk technique)
+ * rather than one band per rowInc rows.
+ * @return true on success, false (with errno set) on failure.
+ */
+bool setupPipeline(bool perThread) {
+    if (!text.open(INFILE)) return false;
+    const char *p = text.data(), *e = p + text.size();
+    for (uint64_t *v : {&N, &S, &K, &rowInc}) {
+        while (p != e && (unsigned char)*p <= ' ') p++;
+        auto [q, ec] = std::from_chars(p, e, *v);
+        if (ec != std::errc()) {
+            errno = EINVAL;
+            return false;
+        }
+        p = q;
+    }
+    textBegin = p, textEnd = e;
+    uint64_t len = textEnd - textBegin;
+    if (perThread) bandBytes = (len + K - 1) / K;
+    else bandBytes = N ? std::max<uint64_t>(1, len / N * rowInc) : len;
+    bandBytes = std::max<uint64_t>(bandBytes, 1);
+    numBands = (len + bandBytes - 1) / bandBytes;
+    return true;
+}
+
+// Streaming runners
+
+/*
+ * In streaming mode the binary matrix file is neither mapped nor loaded whole.
+ * A reader thread reads it band by band with pread into a ring of buffers,
+ * hinting the kernel to read the next band ahead, while the threads claim the
+ * bands in order and count them. A buffer is refilled only once its band has
+ * been counted, so memory use is bounded by the ring however large the matrix.
+ */
+
+/**
+ * @brief Buffer of the ring, holding one band of rows at a time.
+ */
+struct alignas(64) StreamSlot {
+    std::atomic<uint64_t> loaded = 0;   /// Number of bands read into the buffer so far
+    std::atomic<uint64_t> counted = 0;  /// Number of bands counted from the buffer so far
+    char *buf = nullptr;                /// Rows of the current band
+};
+
+int streamFd = -1;                          /// Binary matrix file being streamed
+uint64_t rowBytes, bandRows, numStreamBands;    /// Bytes per row, rows per band, number of bands
+uint64_t numSlots;                          /// Number of buffers in the ring
+std::unique_ptr<StreamSlot[]> slots;        /// Ring of buffers
+std::atomic<int> streamError = 0;           /// errno of the first failed read, if any
+
+/**
+ * @brief Reader thread of streaming mode, reading every band into its buffer.
+ */
+void streamReader() {
+    for (uint64_t b = 0; b < numStreamBands; b++) {
+        StreamSlot &slot = slots[b % numSlots];
+        uint64_t round = b / numSlots;
+        // Wait for the previous band of the buffer to be counted
+        for (uint64_t c; (c = slot.counted.load(std::memory_order_acquire)) < round; )
+            slot.counted.wait(c, std::memory_order_acquire);
+        off_t off = sizeof(MatrixHeader) + b * bandRows * rowBytes;
+        size_t len = std::min(bandRows, N - b * bandRows) * rowBytes;
+        posix_fadvise(streamFd, off + len, bandRows * rowBytes, POSIX_FADV_WILLNEED);
+        for (size_t done = 0; done < len && !streamError; ) {
+            ssize_t got = pread(streamFd, slot.buf + done, len - done, off + done);
+            if (got > 0) done += got;
+            else if (got == 0) streamError = EIO;
+            else if (errno != EINTR) streamError = errno;
+        }
+        // The band is copied out, so its cached pages need not stay in memory
+        posix_fadvise(streamFd, off, len, POSIX_FADV_DONTNEED);
+        slot.loaded.store(round + 1, std::memory_order_release);
+        slot.loaded.notify_all();
+    }
+}
+
+/**
+ * @brief Runner function for streaming mode, claiming bands like the dynamic
+ * technique claims rows.
+ * @param thInfo Thread information.
+ * @return Populated result in `thInfo`.
+ */
+template<class T>
+void streamRunner(ThreadInfo& thInfo) {
+    while (counter.get() < numStreamBands) {
+        uint64_t b = counter.getAndIncrement();
+        if (b >= numStreamBands) break;
+        StreamSlot &slot = slots[b % numSlots];
+        uint64_t round = b / numSlots;
+        for (uint64_t l; (l = slot.loaded.load(std::memory_order_acquire)) <= round; )
+            slot.loaded.wait(l, std::memory_order_acquire);
+        uint64_t rows = std::min(bandRows, N - b * bandRows);
+        for (uint64_t r = 0; r < rows; r++)
+            thInfo.res += countZerosKernel<T>((const T *)(slot.buf + r * rowBytes), N);
+        bytesRead += rows * N * sizeof(T);
+        slot.counted.store(round + 1, std::memory_order_release);
+        slot.counted.notify_all();
+    }
+}
+
+/**
+ * @brief Open a binary matrix file for streaming, and allocate the ring of
+ * buffers within the memory budget. There is one buffer per thread and one
+ * for the reader when the budget allows, and at least two otherwise.
+ * @param file Binary matrix file.
+ * @param budget Most bytes of buffers.
+ * @return true on success, false (with errno set) on failure.
+ */
+template<class T>
+bool openStream(const char *file, uint64_t budget) {
+    MatrixHeader hdr;
+    struct stat st;
+    streamFd = open(file, O_RDONLY);
+    if (streamFd < 0 || pread(streamFd, &hdr, sizeof(hdr), 0) != sizeof(hdr) || fstat(streamFd, &st) < 0)
+        return false;
+    if (std::memcmp(hdr.magic, MatrixHeader::MAGIC, sizeof(hdr.magic)) || hdr.type != ELEM_TYPE<T>
+        || hdr.stride != Matrix<T>::paddedStride(hdr.N)
+        || (uint64_t)st.st_size != sizeof(MatrixHeader) + hdr.N * hdr.stride * sizeof(T)) {
+        errno = EINVAL;
+        return false;
+    }
+    N = hdr.N, S = hdr.S, K = hdr.K, rowInc = hdr.rowInc;
+    rowBytes = hdr.stride * sizeof(T);
+    if (budget / std::max<uint64_t>(rowBytes, 1) < 2) {
+        errno = ENOMEM;
+        return false;
+    }
+    numSlots = std::min(K + 1, budget / rowBytes);
+    // Bands small enough to leave every thread two of them
+    bandRows = std::clamp<uint64_t>(budget / (numSlots * rowBytes), 1, std::max<uint64_t>(N / (2 * K), 1));
+    numStreamBands = (N + bandRows - 1) / bandRows;
+    slots = std::make_unique<StreamSlot[]>(numSlots);
+    for (uint64_t i = 0; i < numSlots; i++) {
+        slots[i].buf = (char *)std::aligned_alloc(Matrix<T>::ROW_ALIGN, std::max<uint64_t>(bandRows * rowBytes, 1));
+        if (!slots[i].buf) return false;
+    }
+    posix_fadvise(streamFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    return true;
+}
+
+/// @brief Runner function for streaming mode, for the element type in use
+void (*streamRunnerOfType)(ThreadInfo&) = NULL;
+
+// Prefix index
+
+/*
+ * The prefix index is built in three steps. Each band of rows, claimed with
+ * the chunk or the dynamic technique, first gets the sums of its own rows
+ * alone, in the only pass over the matrix. The last row of every band is then
+ * completed in order by adding the (completed) last row of the band above.
+ * Finally the other rows of every band add the last row of the band above, in
+ * parallel again.
+ */
+
+PrefixIndex P;                          /// Prefix index, for query mode only
+std::vector<uint64_t> bandStart;        /// First row of the band holding each row
+std::vector<uint64_t> bandEnd;          /// One past the last row of the band starting at each row
+void (*prefixStep)(uint64_t l, uint64_t r) = NULL;  /// Step of the build run on rows [l, r)
+
+/**
+ * @brief First step of the build, for a band of rows.
+ * @param l First row of the band.
+ * @param r One past the last row of the band.
+ */
+template<class T>
+void prefixBand(uint64_t l, uint64_t r) {
+    bandEnd[l] = r;
+    for (uint64_t i = l; i < r; i++) {
+        bandStart[i] = l;
+        std::span<const T> a = A<T>[i];
+        uint32_t *cur = P.row(i + 1), run = 0;
+        cur[0] = 0;
+        for (uint64_t j = 0; j < N; j++) cur[j + 1] = run += !a[j];
+        if (i == l) continue;
+        const uint32_t *above = P.row(i);
+        for (uint64_t j = 1; j <= N; j++) cur[j] += above[j];
+    }
+}
+
+/// @brief First step of the build for the element type in use
+void (*prefixBandOfType)(uint64_t l, uint64_t r) = NULL;
+
+/**
+ * @brief Last step of the build, for rows of any bands.
+ * @param l First row.
+ * @param r One past the last row.
+ */
+void prefixFixRows(uint64_t l, uint64_t r) {
+    for (uint64_t i = l; i < r; i++) {
+        uint64_t b = bandStart[i];
+        // Last rows of bands were completed in order
+        if (!b || i + 1 == bandEnd[b]) continue;
+        uint32_t *cur = P.row(i + 1);
+        const uint32_t *above = P.row(b);
+        for (uint64_t j = 1; j <= N; j++) cur[j] += above[j];
+    }
+}
+
+/**
+ * @brief Runner function for a step of the build, with the chunk technique.
+ * @param thInfo Thread information.
+ */
+void prefixChunkRunner(ThreadInfo& thInfo) {
+    uint64_t l = thInfo.id * (N / K) + std::min(thInfo.id, N % K);
+    uint64_t r = std::min(N, l + N / K + (thInfo.id < N % K));
+    if (l < r) prefixStep(l, r);
+}
+
+/**
+ * @brief Runner function for a step of the build, with the dynamic technique.
+ * Rows are claimed from the shared counter, so the thread information is not
+ * needed.
+ */
+void prefixDynamicRunner(ThreadInfo&) {
+    ChunkSizer sizer(N, rowInc, K);
+    while (counter.get() < N) {
+        uint64_t r = sizer.claim(counter);
+        if (r < sizer.end()) prefixStep(r, sizer.end());
+        sizer.done();
+    }
+}
 
 /**
- * @brief Counter class, implemented using std::atomic objects.
+ * @brief Middle step of the build, completing the last row of every band.
  */
-template<class T>
-class Counter {
-    std::atomic<T> ctr;   /// 64-bit atomic unsigned counter.
-public:
-    /**
-     * @brief Constuctor for Counter Class.
-     * @param n Starting integer for counter, defaults to 0.
-     */
-    Counter(T n = 0) : ctr(n) {}
+void prefixBoundaries() {
+    for (uint64_t l = 0, r; l < N; l = r) {
+        r = bandEnd[l];
+        if (!l) continue;
+        uint32_t *last = P.row(r);
+        const uint32_t *above = P.row(l);
+        for (uint64_t j = 1; j <= N; j++) last[j] += above[j];
+    }
+}
 
-    /**
-     * @brief Method to get current value of counter.
-     * @return Current value of counter.
-     */
-    T get() { return ctr; }
+/**
+ * @brief Rectangle of a batch query, rows [r0, r1) and columns [c0, c1).
+ */
+struct Query { uint32_t r0, c0, r1, c1; };
 
-    /**
-     * @brief Method to get and post-increment counter atomically.
-     * @param inc Amount to increase the counter by.
-     * @return Counter value before increment.
-     */
-    T getAndIncrement(T inc = 1) { return ctr.fetch_add(inc); }
-};
+std::vector<Query> queries;             /// Batch of queries, for query mode only
+std::vector<uint64_t> answers;          /// Zeros in each query of the batch
 
-// Constants
+/**
+ * @brief Runner function answering a chunk of the batch of queries.
+ * @param thInfo Thread information.
+ */
+void queryRunner(ThreadInfo& thInfo) {
+    uint64_t n = queries.size();
+    uint64_t l = thInfo.id * (n / K) + std::min(thInfo.id, n % K);
+    for (uint64_t q = l; q < l + n / K + (thInfo.id < n % K); q++) {
+        const Query &Q = queries[q];
+        answers[q] = P.zeros(Q.r0, Q.c0, Q.r1, Q.c1);
+    }
+}
 
-const char* INFILE = "inp.txt";   /// Input file
-const char* OUTFILE = "out.txt";  /// Output file
+/**
+ * @brief Read a batch query file. Every query is a line of four integers
+ * "r0 c0 r1 c1", asking for the zeros in rows [r0, r1) and columns [c0, c1).
+ * @param file Batch query file.
+ * @return 0 on success, the (1-based) line of the first malformed query, or
+ * -1 (with errno set) if the file cannot be read.
+ */
+int64_t readQueries(const char *file) {
+    MappedFile f;
+    queries.clear();
+    if (!f.open(file)) return errno == EINVAL ? 0 : -1;
+    const char *p = f.data(), *e = p + f.size();
+    for (int64_t line = 1; ; line++) {
+        while (p != e && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        if (p == e) return 0;
+        if (*p == '\n') {
+            p++;
+            continue;
+        }
+        uint64_t v[4];
+        for (uint64_t &x : v) {
+            while (p != e && (*p == ' ' || *p == '\t')) p++;
+            auto [q, ec] = std::from_chars(p, e, x);
+            if (ec != std::errc()) return line;
+            p = q;
+        }
+        if (v[0] > v[2] || v[2] > N || v[1] > v[3] || v[3] > N) return line;
+        // Only blanks may follow the fourth number
+        while (p != e && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        if (p != e && *p++ != '\n') return line;
+        queries.push_back({(uint32_t)v[0], (uint32_t)v[1], (uint32_t)v[2], (uint32_t)v[3]});
+    }
+}
 
-// Global variables
+/**
+ * @brief Make a batch of random queries, for measuring query throughput.
+ * @param count Number of queries.
+ */
+void randomQueries(uint64_t count) {
+    std::mt19937_64 rng(count);
+    queries.resize(count);
+    for (Query &Q : queries) {
+        uint32_t r[2] = {uint32_t(rng() % (N + 1)), uint32_t(rng() % (N + 1))};
+        uint32_t c[2] = {uint32_t(rng() % (N + 1)), uint32_t(rng() % (N + 1))};
+        Q = {std::min(r[0], r[1]), std::min(c[0], c[1]), std::max(r[0], r[1]), std::max(c[0], c[1])};
+    }
+}
 
-uint64_t N, S, K, rowInc, blockSize;
-std::vector<std::vector<int>> A;
-Counter<uint64_t> counter(0);    /// For dynamic methods only
+/**
+ * @brief Write the answers to the batch of queries, one per line.
+ * @param file File to write to.
+ * @return true on success, false (with errno set) on failure.
+ */
+bool writeAnswers(const char *file) {
+    FILE *f = fopen(file, "w");
+    if (!f) return false;
+    std::string buf;
+    char num[24];
+    for (uint64_t a : answers) {
+        buf.append(num, std::to_chars(num, num + sizeof(num), a).ptr);
+        buf += '\n';
+    }
+    bool ok = fwrite(buf.data(), 1, buf.size(), f) == buf.size();
+    return fclose(f) == 0 && ok;
+}
 
-// Thread runners
+// Hardware counter output
 
 /**
- * @brief Runner function for chunk technique.
- * @param thInfo Thread information.
- * @return Populated result in `thInfo`.
+ * @brief Write hardware counters as a JSON object. Counters that were not
+ * read are written as null.
+ * @param fp File to write to.
+ * @param c Counters to write.
  */
-void chunkRunner(ThreadInfo& thInfo) {
-    // Remaining i.e., N % K rows are to be given to first N % K threads.
-    // Find starting row as id * (N / K) + min(id, N % K);
-    uint64_t l = thInfo.id * (N / K) + std::min(thInfo.id, N % K);
-    for (uint64_t i = l; i < std::min(N, l + N / K + (thInfo.id < N % K)); i++) {
-        for (auto &u : A[i]) thInfo.res += !u;
+void writePerfCounts(FILE *fp, const PerfCounts &c) {
+    for (int e = 0; e < PerfCounts::NUM; e++) {
+        fprintf(fp, "%s\"%s\": ", e ? ", " : "", PerfCounts::NAMES[e]);
+        if (c.valid[e]) fprintf(fp, "%lu", c.value[e]);
+        else fprintf(fp, "null");
     }
 }
 
 /**
- * @brief Runner function for mixed technique.
- * @param thInfo Thread information.
- * @return Populated result in `thInfo`.
+ * @brief Write the hardware counters of every thread, and their totals, as
+ * JSON, along with the CPU, running time and bytes read of every thread.
+ * @param file Path of the JSON file to create.
+ * @param tech Name of the technique measured.
+ * @param ms Time taken by the run in milliseconds.
+ * @param threadInfos Information of the threads.
+ * @return true on success, false (with errno set) on failure.
  */
-void mixedRunner(ThreadInfo& thInfo) {
-    for (uint64_t i = thInfo.id; i < N; i += K) {
-        for (auto &u : A[i]) thInfo.res += !u;
+bool writePerfJson(const char *file, const std::string &tech, uint64_t ms, const std::vector<ThreadInfo>& threadInfos) {
+    FILE *fp = fopen(file, "w");
+    if (!fp) return false;
+    PerfCounts total;
+    fprintf(fp, "{\n  \"technique\": \"%s\",\n  \"N\": %lu,\n  \"K\": %lu,\n  \"time_ms\": %lu,\n",
+            tech.c_str(), N, K, ms);
+    fprintf(fp, "  \"error\": ");
+    if (PerfScope::error) fprintf(fp, "\"%s\",\n", std::strerror(PerfScope::error));
+    else fprintf(fp, "null,\n");
+    fprintf(fp, "  \"threads\": [\n");
+    for (auto &thInfo : threadInfos) {
+        fprintf(fp, "    {\"id\": %lu, \"cpu\": %d, \"ns\": %lu, \"bytes\": %lu, ",
+                thInfo.id, thInfo.cpu, thInfo.ns, thInfo.bytes);
+        writePerfCounts(fp, thInfo.perf);
+        fprintf(fp, "}%s\n", thInfo.id + 1 < threadInfos.size() ? "," : "");
+        total.add(thInfo.perf);
     }
+    fprintf(fp, "  ],\n  \"total\": {");
+    writePerfCounts(fp, total);
+    fprintf(fp, "}\n}\n");
+    return fclose(fp) == 0;
 }
 
+// Repeated runs
+
 /**
- * @brief Runner function for dynamic technique.
- * @param thInfo Thread information.
- * @return Populated result in `thInfo`.
+ * @brief Reset the counter and the per-thread results before a run.
+ * @param threadInfos Information of the threads.
+ * @param runner Runner function about to be run.
  */
-void dynamicRunner(ThreadInfo& thInfo) {
-    // Attempt to get a new row
-    while (counter.get() < N) {
-        // Acquire row and increment
-        uint64_t r = counter.getAndIncrement(rowInc);
-        for (uint64_t i = r; i < std::min(r + rowInc, N); i++) {
-            for (auto &u : A[i]) thInfo.res += !u;
+void resetRun(std::vector<ThreadInfo>& threadInfos, void (*runner)(ThreadInfo&)) {
+    counter.set(0);
+    for (auto &thInfo : threadInfos) thInfo.res = thInfo.parsed = thInfo.steals = 0, thInfo.perf = {};
+    if (runner == stealRunner) {
+        // Start every thread off with its rows from the chunk technique
+        ranges = std::vector<RowRange>(K);
+        for (uint64_t i = 0; i < K; i++) {
+            uint64_t l = i * (N / K) + std::min(i, N % K);
+            ranges[i].rows = RowRange::pack(l, l + N / K + (i < N % K));
         }
-    } 
+    }
 }
 
+// Incremental zero counts
+
 /**
- * @brief Runner function for dynamic block technique. We will have blocks of
- * size blockSize. Here, we consider blockSize = sqrt(N) for a total of N blocks
- * to make it comparable to other methods.
+ * @brief Runner function filling in the zero counts of the index, claiming
+ * the blocks of the block technique one at a time.
  * @param thInfo Thread information.
- * @return Populated result in `thInfo`.
+ * @return Populated zeros counted in `thInfo`.
  */
-void dynamicBlockRunner(ThreadInfo& thInfo) {
-    // Compute total number of blocks, which is ceil(N / blockSize) ^ 2.
+template<class T>
+void indexRunner(ThreadInfo& thInfo) {
     uint64_t numBlocks = (N + blockSize - 1) / blockSize;
     uint64_t totalBlocks = numBlocks * numBlocks;
-    // Attempt to get a new block
     while (counter.get() < totalBlocks) {
-        // Acquire block and increment
-        uint64_t b = counter.getAndIncrement(rowInc);
-        for (uint64_t i = b; i < std::min(b + rowInc, totalBlocks); i++) {
-            // Compute (row, col) as (b / K, b % K);
-            uint64_t row = i / numBlocks, col = i % numBlocks;
-            // Now compute limits based on row and col, similar to the chunk case
-            uint64_t rowl = row * (N / numBlocks) + std::min(row, N % numBlocks);
-            uint64_t coll = col * (N / numBlocks) + std::min(col, N % numBlocks);
-            for (uint64_t j = rowl; j < std::min(N, rowl + N / numBlocks + (row < N % numBlocks)); j++)
-                for (uint64_t k = coll; k < std::min(N, coll + N / numBlocks + (col < N % numBlocks)); k++)
-                    thInfo.res += !A[j][k];
+        uint64_t b = counter.getAndIncrement();
+        if (b >= totalBlocks) break;
+        uint64_t row = b / numBlocks, col = b % numBlocks, zeros = 0;
+        uint64_t coll = blockStart(col, numBlocks), colr = blockStart(col + 1, numBlocks);
+        for (uint64_t j = blockStart(row, numBlocks); j < blockStart(row + 1, numBlocks); j++) {
+            uint64_t z = countZeros(j, coll, colr);
+            Z<T>.addRow(j, z);
+            zeros += z;
+        }
+        Z<T>.addBlock(b, zeros);
+        thInfo.res += zeros;
+    }
+}
+
+/// @brief Number of point updates made by each thread of randomUpdateRunner
+uint64_t updatesPerThread;
+
+/**
+ * @brief Runner function making random point updates, each setting an
+ * element to 0 or 1, concurrently with all other threads.
+ * @param thInfo Thread information.
+ */
+template<class T>
+void randomUpdateRunner(ThreadInfo& thInfo) {
+    std::mt19937_64 rng(thInfo.id + std::chrono::steady_clock::now().time_since_epoch().count());
+    for (uint64_t u = 0; u < updatesPerThread; u++) {
+        uint64_t x = rng();
+        Z<T>.set(x % N, (x >> 32) % N, (T)(rng() & 1));
+    }
+}
+
+/**
+ * @brief Parse elements of type T, checking them like the text input.
+ * @param p Text holding the elements, separated by whitespace.
+ * @param vals Populated with the elements.
+ * @param cnt Number of elements to parse.
+ * @return true on success, false (with errno set) on failure.
+ */
+template<class T>
+bool parseElements(const char *p, T *vals, uint64_t cnt) {
+    for (uint64_t k = 0; k < cnt; k++) {
+        char *e;
+        errno = 0;
+        if constexpr (std::is_integral_v<T>) {
+            long long w = strtoll(p, &e, 10);
+            if (e != p && (errno || w < std::numeric_limits<T>::min() || w > std::numeric_limits<T>::max())) errno = ERANGE;
+            vals[k] = (T)w;
+        } else {
+            double w = strtod(p, &e);
+            vals[k] = (T)w;
+            // Tiny values would underflow to zero in a narrower type
+            if (e != p && !vals[k] != !w) errno = ERANGE;
+        }
+        if (e == p) errno = EINVAL;
+        if (errno) return false;
+        p = e;
+    }
+    return true;
+}
+
+/**
+ * @brief Answer a query on the zero counts of the matrix, building them first
+ * if needed. The queries are
+ *   total                          zeros of the matrix
+ *   zrow <i>                       zeros of row i
+ *   blocks <bi0> <bj0> <bi1> <bj1> zeros in block rows [bi0, bi1) and block columns [bj0, bj1)
+ *   set <i> <j> <v>                set element (i, j) to v
+ *   setrow <i> <v>...              overwrite row i with N elements
+ *   setblock <bi> <bj> <v>...      overwrite block (bi, bj) with its elements, row-major
+ *   random <U>                     make U random point updates on each thread at once
+ * Updates are answered with the zeros of the matrix after them.
+ * @param line Query.
+ * @param out Stream of answers.
+ * @param pool Pool of threads to build the counts and make random updates on.
+ * @param threadInfos Information of the threads of the pool.
+ * @return false if the query is not one of the above, true otherwise.
+ */
+template<class T>
+bool indexQuery(const char *line, FILE *out, ThreadPool &pool, std::vector<ThreadInfo>& threadInfos) {
+    static const std::string QUERIES[] = {"total", "zrow", "blocks", "set", "setrow", "setblock", "random"};
+    char cmd[16];
+    if (sscanf(line, "%15s", cmd) != 1 || std::find(std::begin(QUERIES), std::end(QUERIES), cmd) == std::end(QUERIES))
+        return false;
+    std::string cmdName = cmd;
+    uint64_t numBlocks = (N + blockSize - 1) / blockSize;
+    if (!Z<T>.ready()) {
+        Z<T>.reset(A<T>, N, numBlocks);
+        resetRun(threadInfos, indexRunner<T>);
+        pool.run(indexRunner<T>);
+        for (auto &thInfo : threadInfos) Z<T>.addTotal(thInfo.res);
+    }
+    uint64_t a, b, c, d;
+    int off = 0;
+    if (cmdName != "total" && cmdName != "zrow" && cmdName != "blocks" && countZeros == countZerosBitmap) {
+        fprintf(out, "error: the nonzero mask cannot be updated\n");
+    } else if (cmdName == "total") {
+        fprintf(out, "%lu\n", Z<T>.total());
+    } else if (cmdName == "zrow" && sscanf(line, "%*s %lu", &a) == 1 && a < N) {
+        fprintf(out, "%lu\n", Z<T>.row(a));
+    } else if (cmdName == "blocks" && sscanf(line, "%*s %lu %lu %lu %lu", &a, &b, &c, &d) == 4
+               && a <= c && c <= numBlocks && b <= d && d <= numBlocks) {
+        fprintf(out, "%lu\n", Z<T>.blockRect(a, b, c, d));
+    } else if (cmdName == "set" && sscanf(line, "%*s %lu %lu%n", &a, &b, &off) == 2 && a < N && b < N) {
+        T v;
+        if (!parseElements(line + off, &v, 1)) fprintf(out, "error: %s\n", std::strerror(errno));
+        else Z<T>.set(a, b, v), fprintf(out, "%lu\n", Z<T>.total());
+    } else if (cmdName == "setrow" && sscanf(line, "%*s %lu%n", &a, &off) == 1 && a < N) {
+        std::vector<T> vals(N);
+        if (!parseElements(line + off, vals.data(), N)) fprintf(out, "error: %s\n", std::strerror(errno));
+        else Z<T>.setRow(a, vals.data()), fprintf(out, "%lu\n", Z<T>.total());
+    } else if (cmdName == "setblock" && sscanf(line, "%*s %lu %lu%n", &a, &b, &off) == 2 && a < numBlocks && b < numBlocks) {
+        uint64_t rows = blockStart(a + 1, numBlocks) - blockStart(a, numBlocks);
+        std::vector<T> vals(rows * (blockStart(b + 1, numBlocks) - blockStart(b, numBlocks)));
+        if (!parseElements(line + off, vals.data(), vals.size())) fprintf(out, "error: %s\n", std::strerror(errno));
+        else Z<T>.setBlock(a, b, vals.data()), fprintf(out, "%lu\n", Z<T>.total());
+    } else if (cmdName == "random" && sscanf(line, "%*s %lu", &a) == 1) {
+        updatesPerThread = a;
+        pool.run(randomUpdateRunner<T>);
+        fprintf(out, "%lu\n", Z<T>.total());
+    } else {
+        fprintf(out, "error: malformed or out of bounds query\n");
+    }
+    return true;
+}
+
+/// @brief Answers queries on the zero counts of the element type in use, for server mode only
+bool (*indexQueryOfType)(const char *, FILE *, ThreadPool &, std::vector<ThreadInfo>&) = NULL;
+
+// Server mode
+
+/**
+ * @brief Map another binary matrix file of the element type in use, keeping
+ * the number of threads.
+ * @param file Binary matrix file.
+ * @return true on success, false (with errno set) on failure.
+ */
+template<class T>
+bool loadMatrix(const char *file) {
+    MatrixHeader hdr;
+    if (!A<T>.map(file, hdr)) return false;
+    N = hdr.N, S = hdr.S, rowInc = hdr.rowInc;
+    blockSize = int(sqrtl(N));
+    if (countZeros == countZerosBitmap) B.build(A<T>, N);
+    Z<T>.clear();
+    return true;
+}
+
+/// @brief Maps a matrix of the element type in use, for server mode only
+bool (*loadMatrixOfType)(const char *) = NULL;
+
+/**
+ * @brief Value at a percentile of sorted samples, by the nearest rank.
+ * @param sorted Samples in increasing order, at least one.
+ * @param p Percentile in [0, 100].
+ */
+uint64_t percentile(const std::vector<uint64_t> &sorted, double p) {
+    uint64_t rank = std::ceil(p / 100 * sorted.size());
+    return sorted[std::max<uint64_t>(rank, 1) - 1];
+}
+
+/**
+ * @brief Answer queries read line by line, one answer line per query, with
+ * all counts run on a persistent pool of threads. The queries are
+ *   count                     zeros of the whole matrix, with the technique in use
+ *   rect <r0> <c0> <r1> <c1>  zeros in rows [r0, r1) and columns [c0, c1)
+ *   load <FILE>               map another binary matrix file, answering its size
+ * @param in Stream of queries.
+ * @param out Stream of answers.
+ * @param threadInfos Information of the threads, with their CPUs.
+ * @param runner Runner function of the technique in use.
+ * @param numa Whether to place loaded matrices on the NUMA nodes.
+ * @return Latency of each query in nanoseconds.
+ */
+std::vector<uint64_t> serve(FILE *in, FILE *out, std::vector<ThreadInfo>& threadInfos,
+                            void (*runner)(ThreadInfo&), bool numa) {
+    ThreadPool pool(threadInfos);
+    std::vector<uint64_t> latencies;
+    char *line = NULL;
+    size_t cap = 0;
+    while (getline(&line, &cap, in) > 0) {
+        char cmd[16], arg[4096];
+        uint64_t r0, c0, r1, c1;
+        if (sscanf(line, "%15s", cmd) != 1) continue;
+        auto start = std::chrono::steady_clock::now();
+        std::string cmdName = cmd;
+        // Error replies are flushed and timed like any other answer
+        if (cmdName == "count" || (cmdName == "rect" && sscanf(line, "%*s %lu %lu %lu %lu", &r0, &c0, &r1, &c1) == 4)) {
+            if (cmdName == "rect" && (r0 > r1 || r1 > N || c0 > c1 || c1 > N)) {
+                fprintf(out, "error: rectangle out of bounds\n");
+            } else {
+                if (cmdName == "rect") rowLo = r0, colLo = c0, rowHi = r1, colHi = c1;
+                void (*job)(ThreadInfo&) = cmdName == "rect" ? rectRunner : runner;
+                resetRun(threadInfos, job);
+                pool.run(job);
+                uint64_t sm = 0;
+                for (auto &thInfo : threadInfos) sm += thInfo.res;
+                fprintf(out, "%lu\n", sm);
+            }
+        } else if (cmdName == "load" && sscanf(line, "%*s %4095s", arg) == 1) {
+            if (!loadMatrixOfType(arg)) {
+                fprintf(out, "error: %s\n", std::strerror(errno));
+            } else {
+                if (numa) placeMatrixOfType(threadInfos, &pool);
+                fprintf(out, "%lu\n", N);
+            }
+        } else if (!indexQueryOfType(line, out, pool, threadInfos)) {
+            fprintf(out, "error: unknown query\n");
+        }
+        fflush(out);
+        latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+    free(line);
+    return latencies;
+}
+
+/**
+ * @brief Write the matrix along with the input parameters in binary format.
+ * @param file Path of the binary matrix file to create.
+ * @return true on success, false (with errno set) on failure.
+ */
+template<class T>
+bool writeBinary(const char *file) {
+    MatrixHeader hdr{};
+    std::memcpy(hdr.magic, MatrixHeader::MAGIC, sizeof(hdr.magic));
+    hdr.N = N, hdr.S = S, hdr.K = K, hdr.rowInc = rowInc;
+    hdr.stride = Matrix<T>::paddedStride(N);
+    hdr.type = ELEM_TYPE<T>;
+    FILE *fp = fopen(file, "wb");
+    if (!fp) return false;
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+    // Rows are written along with their padding
+    for (uint64_t i = 0; ok && i < N; i++)
+        ok = fwrite(A<T>[i].data(), sizeof(T), hdr.stride, fp) == hdr.stride;
+    return fclose(fp) == 0 && ok;
+}
+
+/**
+ * @brief Read an element from standard input, checking that it is
+ * representable in T without changing whether it is zero.
+ * @param v Populated with the element.
+ * @return true on success, false (with errno set) on failure.
+ */
+template<class T>
+bool readElement(T &v) {
+    // Integers are read wide so that out of range elements can be detected
+    using W = std::conditional_t<std::is_integral_v<T>, long long, double>;
+    W w;
+    if (!(std::cin >> w)) {
+        errno = EIO;
+        return false;
+    }
+    v = (T)w;
+    if constexpr (std::is_integral_v<T>) {
+        if (w < std::numeric_limits<T>::min() || w > std::numeric_limits<T>::max()) {
+            errno = ERANGE;
+            return false;
+        }
+    } else if (!v != !w) {
+        // Tiny values would underflow to zero in a narrower type
+        errno = ERANGE;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Read the matrix elements from standard input.
+ * @return true on success, false (with errno set) on failure.
+ */
+template<class T>
+bool readText() {
+    A<T>.assign(N);
+    for (uint64_t i = 0; i < N; i++) {
+        for (T *v = A<T>.row(i), *e = v + N; v != e; v++) {
+            if (!readElement(*v)) return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Sparse formats of the text input. Both start with the line
+ * "N S K rowInc NNZ", NNZ being the number of stored entries. In CSR form it
+ * is followed by the N + 1 row pointers, the NNZ column indices and the NNZ
+ * values. In COO form it is followed by NNZ entries "i j v" in any order.
+ */
+enum InputFormat { DENSE, CSR, COO };
+
+/**
+ * @brief Read the stored entries of a sparse matrix from standard input.
+ * @param format Sparse format of the input.
+ * @return true on success, false (with errno set) on failure.
+ */
+template<class T>
+bool readSparse(InputFormat format) {
+    uint64_t nnz;
+    if (!(std::cin >> nnz) || N > std::numeric_limits<uint32_t>::max()) {
+        errno = EINVAL;
+        return false;
+    }
+    std::vector<uint64_t> rowPtr(N + 1, 0);
+    std::vector<uint32_t> colIdx(nnz);
+    std::vector<T> vals(nnz);
+    if (format == CSR) {
+        for (uint64_t &p : rowPtr) std::cin >> p;
+        for (uint32_t &c : colIdx) std::cin >> c;
+        for (T &v : vals)
+            if (!readElement(v)) return false;
+    } else {
+        // Bucket the entries by row, keeping their order within a row
+        std::vector<uint64_t> rows(nnz);
+        std::vector<uint32_t> cols(nnz);
+        std::vector<T> elems(nnz);
+        for (uint64_t k = 0; k < nnz; k++) {
+            if (!(std::cin >> rows[k] >> cols[k]) || rows[k] >= N) {
+                errno = EINVAL;
+                return false;
+            }
+            if (!readElement(elems[k])) return false;
+            rowPtr[rows[k] + 1]++;
+        }
+        for (uint64_t i = 0; i < N; i++) rowPtr[i + 1] += rowPtr[i];
+        std::vector<uint64_t> next(rowPtr.begin(), rowPtr.end() - 1);
+        for (uint64_t k = 0; k < nnz; k++) {
+            uint64_t at = next[rows[k]]++;
+            colIdx[at] = cols[k], vals[at] = elems[k];
+        }
+    }
+    if (!std::cin) {
+        errno = EIO;
+        return false;
+    }
+    return C<T>.assign(N, std::move(rowPtr), std::move(colIdx), std::move(vals));
+}
+
+/**
+ * @brief Load the matrix with elements of type T, and set up the inner kernel
+ * of the runners. Converts the matrix to a binary matrix file if requested.
+ * @param binFile Binary matrix file to map, or NULL to read the text input.
+ * @param convFile Binary matrix file to convert to, or NULL.
+ * @param kernel Name of the zero-count kernel to use.
+ * @param bitmap Whether to count over the nonzero mask of the matrix.
+ * @param budget Most bytes of buffers to stream binFile through, or 0 to map it.
+ * @param format Format of the text input.
+ * @return true on success, false (after reporting the error) on failure.
+ */
+template<class T>
+bool setup(const char *binFile, const char *convFile, const std::string &kernel, bool bitmap, uint64_t budget,
+           InputFormat format) {
+    placeMatrixOfType = placeMatrix<T>;
+    loadMatrixOfType = loadMatrix<T>;
+    indexQueryOfType = indexQuery<T>;
+    prefixBandOfType = prefixBand<T>;
+    const Kernel<T> *k = selectKernel<T>(kernel);
+    if (!k) {
+        std::cerr << "[ERROR] Kernel " << kernel << " is not supported on this CPU" << std::endl;
+        return false;
+    }
+    countZerosKernel<T> = k->count;
+    countZeros = countZerosDense<T>;
+    if (binFile && budget) {
+        // Stream the matrix instead of mapping it
+        if (!openStream<T>(binFile, budget)) {
+            std::cerr << "[ERROR] Streaming binary matrix file " << binFile << " failed: "
+                      << std::strerror(errno) << std::endl;
+            return false;
         }
+        streamRunnerOfType = streamRunner<T>;
+    } else if (binFile) {
+        // Read inputs straight off the mapped pages
+        MatrixHeader hdr;
+        if (!A<T>.map(binFile, hdr)) {
+            std::cerr << "[ERROR] Mapping binary matrix file " << binFile << " failed: "
+                      << std::strerror(errno) << std::endl;
+            return false;
+        }
+        N = hdr.N, S = hdr.S, K = hdr.K, rowInc = hdr.rowInc;
+    } else {
+        if (!freopen(INFILE, "r", stdin)) {
+            std::cerr << "[ERROR] Opening input file " << INFILE << " failed: " 
+                      << std::strerror(errno) << std::endl;
+            return false;
+        }
+        // Read inputs
+        std::cin >> N >> S >> K >> rowInc;
+        if (format != DENSE) countZeros = countZerosSparse<T>;
+        if (format == DENSE ? !readText<T>() : !readSparse<T>(format)) {
+            std::cerr << "[ERROR] Reading input file " << INFILE << " failed: "
+                      << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    if (convFile && !writeBinary<T>(convFile)) {
+        std::cerr << "[ERROR] Writing binary matrix file " << convFile << " failed: "
+                  << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (bitmap) {
+        // Preprocess the matrix once into its nonzero mask
+        B.build(A<T>, N);
+        countZeros = countZerosBitmap;
     }
+    return true;
 }
 
 /**
@@ -144,8 +2433,23 @@ void dynamicBlockRunner(ThreadInfo& thInfo) {
 void help(std::string name) {
     std::cerr << "Usage: " << name << " [options]\n\n"
               << "Options:\n"
-              << "  -h,--help                                  Display this information\n"
-              << "  -t,--technique {chunk|mixed|dynamic|block} Use the specified technique for computing matrix sparsity"
+              << "  -h,--help                                        Display this information\n"
+              << "  -t,--technique {chunk|mixed|dynamic|block|steal} Use the specified technique for computing matrix sparsity\n"
+              << "  -g,--grain     {fixed|guided|adaptive}           Claim size of the dynamic and block techniques (default: fixed)\n"
+              << "  -k,--kernel    {auto|avx512|avx2|sse2|scalar}    Use the specified zero-count kernel (default: auto)\n"
+              << "  -e,--element   {int8|int16|int32|float|double}   Store the text input with the specified element type (default: int32)\n"
+              << "  -f,--format    {dense|csr|coo}                   Read " << INFILE << " in the specified format (default: dense)\n"
+              << "  -m,--bitmap                                      Count over a precomputed 1-bit-per-element nonzero mask\n"
+              << "  -a,--affinity  {none|compact|scatter}            Pin the threads to CPUs with the specified policy (default: none)\n"
+              << "  -n,--numa                                        Place each row on the NUMA node of the thread counting it\n"
+              << "  -s,--server                                      Answer count queries from standard input on a persistent thread pool\n"
+              << "  -q,--queries   <FILE>                            Answer the batch of rectangle queries in FILE with a prefix index\n"
+              << "  -r,--random    <COUNT>                           Measure the throughput of COUNT random rectangle queries\n"
+              << "  -p,--pipeline                                    Decode " << INFILE << " in parallel and count each band of rows as it is decoded\n"
+              << "  -b,--binary    <FILE>                            Map the binary matrix FILE instead of reading " << INFILE << "\n"
+              << "  -M,--memory    <MIB>                             Stream the binary matrix FILE through at most MIB MiB of buffers\n"
+              << "  -P,--perf                                        Record hardware counters of every thread in " << PERFFILE << "\n"
+              << "  -c,--convert   <FILE>                            Convert " << INFILE << " to the binary matrix FILE and exit"
               << std::endl;
 }
 
@@ -157,6 +2461,23 @@ int main(int argc, char* argv[]) {
     }
     // Runner function to use in threads
     void (*runner) (ThreadInfo&) = NULL;
+    // Binary matrix files to read from or convert to
+    const char *binFile = NULL, *convFile = NULL;
+    // Zero-count kernel used by all runners
+    std::string kernel = "auto";
+    // Element type of the matrix, binary matrix files carry their own
+    ElemType type = INT32;
+    bool bitmap = false, pipeline = false, numa = false, server = false;
+    // Batch query file, and number of random queries, for query mode
+    const char *queryFile = NULL;
+    uint64_t numRandom = 0;
+    // Memory budget in bytes for streaming mode, 0 to map binary matrix files
+    uint64_t budget = 0;
+    // Format of the text input
+    InputFormat format = DENSE;
+    // Policy for pinning threads to CPUs
+    Topology::Policy affinity = Topology::NONE;
+    std::string tech = "";
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
         if (arg == "-h" || arg == "--help") {
@@ -164,57 +2485,291 @@ int main(int argc, char* argv[]) {
             return 0;
         } else if (arg == "-t" || arg == "--technique") {
             i++;
-            std::string tech = argv[i];
-            if (tech == "chunk") runner = chunkRunner;
-            else if (tech == "mixed") runner = mixedRunner;
-            else if (tech == "dynamic") runner = dynamicRunner;
-            else if (tech == "block") runner = dynamicBlockRunner;
+            tech = argv[i];
+        } else if (arg == "-g" || arg == "--grain") {
+            i++;
+            std::string grain = argv[i];
+            if (grain == "fixed") ChunkSizer::grain = ChunkSizer::FIXED;
+            else if (grain == "guided") ChunkSizer::grain = ChunkSizer::GUIDED;
+            else if (grain == "adaptive") ChunkSizer::grain = ChunkSizer::ADAPTIVE;
+            else {
+                help(argv[0]);
+                return 1;
+            }
+        } else if (arg == "-a" || arg == "--affinity") {
+            i++;
+            std::string policy = argv[i];
+            if (policy == "none") affinity = Topology::NONE;
+            else if (policy == "compact") affinity = Topology::COMPACT;
+            else if (policy == "scatter") affinity = Topology::SCATTER;
             else {
                 help(argv[0]);
                 return 1;
             }
+        } else if (arg == "-n" || arg == "--numa") {
+            numa = true;
+        } else if (arg == "-s" || arg == "--server") {
+            server = true;
+        } else if (arg == "-q" || arg == "--queries") {
+            i++;
+            queryFile = argv[i];
+        } else if (arg == "-r" || arg == "--random") {
+            i++;
+            numRandom = strtoull(argv[i], NULL, 10);
+        } else if (arg == "-p" || arg == "--pipeline") {
+            pipeline = true;
+        } else if (arg == "-k" || arg == "--kernel") {
+            i++;
+            kernel = argv[i];
+        } else if (arg == "-e" || arg == "--element") {
+            i++;
+            std::string elem = argv[i];
+            if (elem == "int8") type = INT8;
+            else if (elem == "int16") type = INT16;
+            else if (elem == "int32") type = INT32;
+            else if (elem == "float") type = FLOAT;
+            else if (elem == "double") type = DOUBLE;
+            else {
+                help(argv[0]);
+                return 1;
+            }
+        } else if (arg == "-f" || arg == "--format") {
+            i++;
+            std::string fmt = argv[i];
+            if (fmt == "dense") format = DENSE;
+            else if (fmt == "csr") format = CSR;
+            else if (fmt == "coo") format = COO;
+            else {
+                help(argv[0]);
+                return 1;
+            }
+        } else if (arg == "-m" || arg == "--bitmap") {
+            bitmap = true;
+        } else if (arg == "-b" || arg == "--binary") {
+            i++;
+            binFile = argv[i];
+        } else if (arg == "-M" || arg == "--memory") {
+            i++;
+            budget = strtoull(argv[i], NULL, 10) << 20;
+            if (!budget) {
+                help(argv[0]);
+                return 1;
+            }
+        } else if (arg == "-P" || arg == "--perf") {
+            PerfScope::enabled = true;
+        } else if (arg == "-c" || arg == "--convert") {
+            i++;
+            convFile = argv[i];
         } else {
             help(argv[0]);
             return 1;
         }
     }
+    if (tech == "chunk") runner = pipeline ? pipelinedChunkRunner : chunkRunner;
+    else if (tech == "mixed") runner = pipeline ? pipelinedMixedRunner : mixedRunner;
+    else if (tech == "dynamic") runner = pipeline ? pipelinedDynamicRunner : dynamicRunner;
+    else if (tech == "block" && !pipeline) runner = dynamicBlockRunner;
+    else if (tech == "steal" && !pipeline) runner = stealRunner;
+    else if (tech != "" || !convFile) {
+        help(argv[0]);
+        return 1;
+    }
+    if (pipeline && (binFile || convFile || bitmap || type != INT32)) {
+        std::cerr << "[ERROR] Pipelined mode only counts the integers of " << INFILE << std::endl;
+        return 1;
+    }
+    if (server && pipeline) {
+        std::cerr << "[ERROR] Server mode needs the matrix loaded before the first query" << std::endl;
+        return 1;
+    }
+    bool query = queryFile || numRandom;
+    if (query && (pipeline || server || (runner != chunkRunner && runner != dynamicRunner))) {
+        std::cerr << "[ERROR] Query mode builds its index with the chunk or dynamic technique only" << std::endl;
+        return 1;
+    }
+    if (budget && (!binFile || runner != dynamicRunner || convFile || bitmap || numa || server || query)) {
+        std::cerr << "[ERROR] Streaming mode counts a binary matrix file with the dynamic technique only" << std::endl;
+        return 1;
+    }
+    if (format != DENSE && (binFile || convFile || bitmap || pipeline || numa || server || query)) {
+        std::cerr << "[ERROR] Sparse input is only counted in place, with any technique" << std::endl;
+        return 1;
+    }
+    if (numa && (pipeline || bitmap)) {
+        std::cerr << "[ERROR] NUMA mode only places the elements of the matrix" << std::endl;
+        return 1;
+    }
+    // Rows are placed by pinned threads, scattered over the nodes unless told otherwise
+    if (numa && affinity == Topology::NONE) affinity = Topology::SCATTER;
+    if (affinity != Topology::NONE) topology.load();
+    // Queries are read from the original standard input, which the text input replaces
+    FILE *queryIn = server ? fdopen(dup(STDIN_FILENO), "r") : NULL;
     // Setup input and output filestreams
     std::cin.tie(0)->sync_with_stdio(0);
-    if (!freopen(INFILE, "r", stdin)) {
-        std::cerr << "[ERROR] Opening input file " << INFILE << " failed: " 
-                  << std::strerror(errno) << std::endl;
-        return 1;
+    if (pipeline) {
+        if (!setupPipeline(tech == "chunk")) {
+            std::cerr << "[ERROR] Mapping input file " << INFILE << " failed: "
+                      << std::strerror(errno) << std::endl;
+            return 1;
+        }
+    } else if (binFile) {
+        MatrixHeader hdr;
+        if (!readHeader(binFile, hdr)) {
+            std::cerr << "[ERROR] Reading binary matrix file " << binFile << " failed: "
+                      << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        type = hdr.type;
     }
+    bool ok = pipeline;
+    if (!pipeline) switch (type) {
+        case INT8: ok = setup<int8_t>(binFile, convFile, kernel, bitmap, budget, format); break;
+        case INT16: ok = setup<int16_t>(binFile, convFile, kernel, bitmap, budget, format); break;
+        case INT32: ok = setup<int>(binFile, convFile, kernel, bitmap, budget, format); break;
+        case FLOAT: ok = setup<float>(binFile, convFile, kernel, bitmap, budget, format); break;
+        case DOUBLE: ok = setup<double>(binFile, convFile, kernel, bitmap, budget, format); break;
+        default:
+            std::cerr << "[ERROR] Unknown element type " << type << " in " << binFile << std::endl;
+    }
+    if (!ok) return 1;
+    if (convFile) return 0;
+    if (budget) runner = streamRunnerOfType;
+    // Answers go to standard output, and the statistics to the output file
+    FILE *answerOut = server ? fdopen(dup(STDOUT_FILENO), "w") : NULL;
     if (!freopen(OUTFILE, "w", stdout)) {
         std::cerr << "[ERROR] Opening output file " << OUTFILE << " failed: " 
                   << std::strerror(errno) << std::endl;
         return 1;
     }
-    // Read inputs
-    std::cin >> N >> S >> K >> rowInc;
     // Set up block size
     blockSize = int(sqrtl(N));
-    A.assign(N, std::vector<int> (N));
-    for (auto &u : A) for (auto &v : u) std::cin >> v;
     // Set up threads and respective ThreadInfo structs to be passed
-    std::vector<std::thread> threads(K);
     std::vector<ThreadInfo> threadInfos(K);
-    for (uint64_t i = 0; i < K; i++) threadInfos[i].id = i, threadInfos[i].res = 0;
+    for (uint64_t i = 0; i < K; i++)
+        threadInfos[i] = {i, 0, 0, 0, 0, 0, affinity == Topology::NONE ? -1 : topology.cpuFor(i, affinity)};
+    if (numa) {
+        interleavedRows = runner == mixedRunner;
+        placeMatrixOfType(threadInfos, NULL);
+    }
+    if (query) {
+        if (N > PrefixIndex::MAX_N) {
+            std::cerr << "[ERROR] Query mode indexes at most " << PrefixIndex::MAX_N << " rows" << std::endl;
+            return 1;
+        }
+        void (*prefixRunner)(ThreadInfo&) = runner == chunkRunner ? prefixChunkRunner : prefixDynamicRunner;
+        P.assign(N);
+        bandStart.assign(N, 0);
+        bandEnd.assign(N, 0);
+        // Build the prefix index
+        auto startTime = std::chrono::high_resolution_clock::now();
+        prefixStep = prefixBandOfType;
+        resetRun(threadInfos, prefixRunner);
+        runThreads(threadInfos, prefixRunner);
+        prefixBoundaries();
+        prefixStep = prefixFixRows;
+        resetRun(threadInfos, prefixRunner);
+        runThreads(threadInfos, prefixRunner);
+        auto builtTime = std::chrono::high_resolution_clock::now();
+        if (queryFile) {
+            int64_t line = readQueries(queryFile);
+            if (line) {
+                std::cerr << "[ERROR] Reading batch query file " << queryFile << " failed: ";
+                if (line < 0) std::cerr << std::strerror(errno) << std::endl;
+                else std::cerr << "malformed or out of bounds query on line " << line << std::endl;
+                return 1;
+            }
+        } else {
+            randomQueries(numRandom);
+        }
+        answers.assign(queries.size(), 0);
+        // Answer the queries
+        auto queryTime = std::chrono::high_resolution_clock::now();
+        runThreads(threadInfos, queryRunner);
+        auto endTime = std::chrono::high_resolution_clock::now();
+        if (queryFile && !writeAnswers(ANSFILE)) {
+            std::cerr << "[ERROR] Writing answers file " << ANSFILE << " failed: "
+                      << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - queryTime).count();
+        std::cout << "Time taken to build the prefix index: "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(builtTime - startTime).count() << " ms\n"
+                  << "Total number of zero-valued elements in the matrix: " << P.zeros(0, 0, N, N) << '\n'
+                  << "Time taken to answer the queries: "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(endTime - queryTime).count() << " ms\n"
+                  << "Number of queries answered: " << queries.size() << '\n'
+                  << "Query throughput: " << (ns ? queries.size() * 1e9 / ns : 0) << " queries/s\n";
+        return 0;
+    }
+    if (server) {
+        std::vector<uint64_t> latencies = serve(queryIn, answerOut, threadInfos, runner, numa);
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << "Number of queries answered: " << latencies.size() << '\n';
+        if (!latencies.empty())
+            for (double p : {50.0, 90.0, 99.0, 100.0})
+                std::cout << "Latency at percentile " << p << ": " << percentile(latencies, p) / 1000.0 << " us\n";
+        return 0;
+    }
+    resetRun(threadInfos, runner);
     // Start timer
     auto startTime = std::chrono::high_resolution_clock::now();
-    // Run threads and join them
-    for (uint64_t i = 0; i < K; i++) threads[i] = std::thread(runner, std::ref(threadInfos[i]));
-    for (auto& th : threads) th.join();
+    // Run threads and join them, with the reader in streaming mode
+    std::thread reader;
+    if (budget) reader = std::thread(streamReader);
+    runThreads(threadInfos, runner);
+    if (budget) reader.join();
     // Finish timer
     auto endTime = std::chrono::high_resolution_clock::now();
     auto tm = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
+    if (pipeline) {
+        uint64_t parsed = 0;
+        for (auto &thInfo : threadInfos) parsed += thInfo.parsed;
+        if (malformed || parsed != N * N) {
+            std::cerr << "[ERROR] Input file " << INFILE << " does not hold " << N << " x " << N
+                      << " integers" << std::endl;
+            return 1;
+        }
+    }
+    if (streamError) {
+        std::cerr << "[ERROR] Reading binary matrix file " << binFile << " failed: "
+                  << std::strerror(streamError) << std::endl;
+        return 1;
+    }
+    if (PerfScope::enabled && !writePerfJson(PERFFILE, tech, tm.count(), threadInfos)) {
+        std::cerr << "[ERROR] Writing hardware counter file " << PERFFILE << " failed: "
+                  << std::strerror(errno) << std::endl;
+        return 1;
+    }
     // Collect and output statistics
     std::cout << "Time taken to count the number of zeros: " << tm.count() << " ms\n";
-    int sm = 0;
+    uint64_t sm = 0;
     for (auto &thInfo : threadInfos) sm += thInfo.res;
     std::cout << "Total number of zero-valued elements in the matrix: " << sm << '\n';
     for (auto &thInfo : threadInfos) 
         std::cout << "Number of zero-valued elements counted by thread" 
                   << thInfo.id << ": " << thInfo.res << '\n';
+    if (runner == stealRunner)
+        for (auto &thInfo : threadInfos)
+            std::cout << "Number of steals by thread" << thInfo.id << ": " << thInfo.steals << '\n';
+    if (budget)
+        std::cout << "Memory used by stream buffers: " << numSlots * bandRows * rowBytes << " bytes ("
+                  << numSlots << " buffers of " << bandRows << " rows, " << numStreamBands << " bands)\n";
+    if (affinity != Topology::NONE && !pipeline) {
+        // Every node streams its bytes for as long as its slowest thread runs
+        std::vector<int> nodes;
+        for (auto &thInfo : threadInfos) nodes.push_back(topology.nodeOf(thInfo.cpu));
+        std::vector<int> seen = nodes;
+        std::sort(seen.begin(), seen.end());
+        seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+        for (int node : seen) {
+            uint64_t bytes = 0, ns = 0, threadsOnNode = 0;
+            for (uint64_t i = 0; i < K; i++) {
+                if (nodes[i] != node) continue;
+                bytes += threadInfos[i].bytes, ns = std::max(ns, threadInfos[i].ns), threadsOnNode++;
+            }
+            std::cout << "Bandwidth of node" << node << ": " << (ns ? (double)bytes / ns : 0) << " GB/s ("
+                      << bytes << " bytes read by " << threadsOnNode << " threads)\n";
+        }
+    }
     return 0;
 }
\ No newline at end of file
@@ -19,22 +19,118 @@
 #include <chrono>
 #include <cstring>
 #include <cmath>
+#include <algorithm>
 #include <map>
 #include <functional>
 #include <pthread.h>
 #include <omp.h>
 #include <cassert>
+#include <span>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 
 // Classes and structs
 
 /**
- * @brief Information contained by a thread.
+ * @brief Hardware counters of a thread. Each counter is scaled up for the time
+ * it was not scheduled on the PMU, and is marked invalid if the kernel does not
+ * expose it.
  */
-struct ThreadInfo {
+struct PerfCounts {
+    /// @brief Counters recorded, in the order of NAMES
+    enum Event { CYCLES, INSTRUCTIONS, LLC_MISSES, L1D_MISSES, NODE_MISSES, NUM };
+    /// @brief Names of the counters in the JSON output
+    static constexpr const char *NAMES[NUM] = {"cycles", "instructions", "llc_misses", "l1d_misses", "node_misses"};
+
+    uint64_t value[NUM] = {};   /// Value of each counter
+    bool valid[NUM] = {};       /// Whether each counter was read
+
+    /**
+     * @brief Add the counters of another thread.
+     * @param o Counters to add.
+     */
+    void add(const PerfCounts &o) {
+        for (int e = 0; e < NUM; e++) value[e] += o.value[e], valid[e] |= o.valid[e];
+    }
+};
+
+/**
+ * @brief Information contained by a thread. Each struct sits on its own cache
+ * line, so that threads storing their results never share a line.
+ */
+struct alignas(64) ThreadInfo {
+    uint64_t id;        /// Thread id
+    uint64_t res;       /// Result of thread computation
+    PerfCounts perf;    /// Hardware counters of the thread, for perf mode only
+};
+
+/**
+ * @brief Layout of ThreadInfo before it was padded, four structs to a cache
+ * line. Only used to measure the coherence traffic saved by ThreadInfo.
+ */
+struct PackedThreadInfo {
     uint64_t id;    /// Thread id
     int res;        /// Result of thread computation
 };
 
+/**
+ * @brief Scoped hardware counters of the calling thread, read through
+ * perf_event_open(2). The counts are added to `out` when the scope ends.
+ * Nothing is counted unless perf mode is on, and counters the kernel does not
+ * expose are skipped; the reason for a failure is kept in `error`. L1D read
+ * misses stand in for the cache lines pulled in from other caches, and NUMA
+ * node misses for the reads served by remote memory.
+ */
+class PerfScope {
+    int fd[PerfCounts::NUM];    /// Counter file descriptors
+    PerfCounts &out;            /// Where to add the counts
+public:
+    static inline bool enabled = false;         /// Whether perf mode is on
+    static inline std::atomic<int> error = 0;   /// errno of the last failed open
+
+    PerfScope(PerfCounts &_out) : out(_out) {
+        static const std::pair<uint32_t, uint64_t> EVENTS[PerfCounts::NUM] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8
+                                 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_NODE | PERF_COUNT_HW_CACHE_OP_READ << 8
+                                 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+        };
+        std::fill_n(fd, PerfCounts::NUM, -1);
+        if (!enabled) return;
+        for (int e = 0; e < PerfCounts::NUM; e++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = EVENTS[e].first;
+            attr.config = EVENTS[e].second;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.exclude_kernel = attr.exclude_hv = 1;
+            fd[e] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fd[e] < 0) error = errno;
+        }
+    }
+
+    ~PerfScope() {
+        for (int e = 0; e < PerfCounts::NUM; e++) {
+            // Value, time enabled and time running
+            uint64_t cnt[3];
+            if (fd[e] < 0) continue;
+            if (read(fd[e], cnt, sizeof(cnt)) == sizeof(cnt) && cnt[2]) {
+                out.value[e] += (uint64_t)((double)cnt[0] * cnt[1] / cnt[2]);
+                out.valid[e] = true;
+            }
+            close(fd[e]);
+        }
+    }
+};
+
 /**
  * @brief Counter class, implemented using std::atomic objects.
  */
@@ -62,10 +158,187 @@ public:
     T getAndIncrement(T inc = 1) { return ctr.fetch_add(inc); }
 };
 
+/**
+ * @brief Chooses how much work a thread of a dynamic technique claims from the
+ * shared counter at a time. With the fixed grain every claim is of `fixed`
+ * units. With the guided grain claims start large and shrink with the work
+ * left. With the adaptive grain claims are sized from the measured time per
+ * unit of work and the measured cost of a claim (which grows with contention
+ * on the counter), so that claiming stays a small fraction of the work; they
+ * are still capped by the guided size to keep the tail balanced.
+ */
+class ChunkSizer {
+public:
+    enum Grain { FIXED, GUIDED, ADAPTIVE };
+
+    static inline Grain grain = FIXED;          /// Grain used by all dynamic techniques
+    static constexpr double CLAIM_RATIO = 64;   /// Target ratio of work to claim time
+    static constexpr double EWMA_WEIGHT = 0.25; /// Weight of the newest measurement
+
+private:
+    using Clock = std::chrono::steady_clock;
+    uint64_t total, fixed, threads;     /// Units of work, fixed claim size, number of threads
+    uint64_t first = 0, last = 0;       /// Current claim [first, last)
+    double claimNs = 0, unitNs = 0;     /// Averaged time per claim and per unit
+    Clock::time_point claimedAt;        /// When the current claim was made
+
+    static double average(double avg, double sample) {
+        return avg ? (1 - EWMA_WEIGHT) * avg + EWMA_WEIGHT * sample : sample;
+    }
+
+public:
+    /**
+     * @brief Constructor for ChunkSizer, one per thread.
+     * @param _total Number of units of work (rows or blocks).
+     * @param _fixed Claim size for the fixed grain.
+     * @param _threads Number of threads sharing the work.
+     */
+    ChunkSizer(uint64_t _total, uint64_t _fixed, uint64_t _threads)
+        : total(_total), fixed(std::max<uint64_t>(_fixed, 1)), threads(std::max<uint64_t>(_threads, 1)) {}
+
+    /**
+     * @brief Claim the next chunk of work from the shared counter.
+     * @param ctr Shared counter of claimed units.
+     * @return First unit of the claimed chunk, which ends at `end()`.
+     */
+    uint64_t claim(Counter<uint64_t> &ctr) {
+        uint64_t inc = fixed;
+        if (grain != FIXED) {
+            // Half of a fair share of the work left
+            uint64_t left = total - std::min(total, ctr.get());
+            inc = std::max<uint64_t>(1, left / (2 * threads));
+            // The first adaptive claim is a single unit, to time it
+            if (grain == ADAPTIVE)
+                inc = unitNs ? std::clamp<uint64_t>(CLAIM_RATIO * claimNs / unitNs, 1, inc) : 1;
+        }
+        if (grain != ADAPTIVE) {
+            first = ctr.getAndIncrement(inc);
+        } else {
+            auto start = Clock::now();
+            first = ctr.getAndIncrement(inc);
+            claimedAt = Clock::now();
+            claimNs = average(claimNs, std::chrono::duration<double, std::nano>(claimedAt - start).count());
+        }
+        last = std::min(first + inc, total);
+        return first;
+    }
+
+    /**
+     * @brief End of the current claim.
+     * @return One past the last unit of the claimed chunk.
+     */
+    uint64_t end() const { return last; }
+
+    /**
+     * @brief Tell the sizer that the current claim has been worked through.
+     */
+    void done() {
+        if (grain != ADAPTIVE || first >= last) return;
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - claimedAt).count();
+        unitNs = average(unitNs, ns / (last - first));
+    }
+};
+
+/**
+ * @brief Header of the binary matrix format. It carries the same parameters as
+ * the first line of the text input, and is padded to 64 bytes so that the
+ * row-major matrix of 32-bit integers following it is cache line aligned.
+ */
+struct MatrixHeader {
+    static constexpr char MAGIC[8] = {'S', 'P', 'M', 'A', 'T', 'v', '1', '\0'};
+
+    char magic[8];      /// Magic bytes, always equal to MAGIC
+    uint64_t N;         /// Number of rows (and columns) of the matrix
+    uint64_t S;         /// Sparsity (in percent) of the matrix
+    uint64_t K;         /// Number of threads
+    uint64_t rowInc;    /// Row increment for dynamic techniques
+    char pad[24];       /// Padding up to 64 bytes
+};
+static_assert(sizeof(MatrixHeader) == 64, "MatrixHeader must span one cache line");
+
+/**
+ * @brief Square matrix of integers stored contiguously in row-major order. The
+ * elements either live in memory owned by the matrix (text input) or in the
+ * read-only pages of a memory-mapped binary matrix file.
+ */
+class Matrix {
+    uint64_t n = 0;             /// Number of rows (and columns)
+    std::vector<int> storage;   /// Owned storage, unused when mapped
+    const int *base = nullptr;  /// First element of the matrix
+    void *mapAddr = MAP_FAILED; /// Address of the mapping, if any
+    size_t mapLen = 0;          /// Length of the mapping in bytes
+public:
+    Matrix() = default;
+    Matrix(const Matrix&) = delete;
+    Matrix& operator=(const Matrix&) = delete;
+    ~Matrix() { if (mapAddr != MAP_FAILED) munmap(mapAddr, mapLen); }
+
+    /**
+     * @brief Allocate owned storage for an n x n matrix of zeros.
+     * @param _n Number of rows (and columns).
+     */
+    void assign(uint64_t _n) {
+        n = _n;
+        storage.assign(n * n, 0);
+        base = storage.data();
+    }
+
+    /**
+     * @brief Map a binary matrix file into memory. No element is copied or
+     * parsed; the runners read the mapped pages directly.
+     * @param file Path of the binary matrix file.
+     * @param hdr Populated with the header of the file.
+     * @return true on success, false (with errno set) on failure.
+     */
+    bool map(const char *file, MatrixHeader &hdr) {
+        int fd = open(file, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) < 0) {
+            close(fd);
+            return false;
+        }
+        if ((size_t)st.st_size < sizeof(MatrixHeader)) {
+            close(fd);
+            errno = EINVAL;
+            return false;
+        }
+        mapLen = st.st_size;
+        mapAddr = mmap(NULL, mapLen, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping keeps its own reference to the file
+        close(fd);
+        if (mapAddr == MAP_FAILED) return false;
+        std::memcpy(&hdr, mapAddr, sizeof(MatrixHeader));
+        if (std::memcmp(hdr.magic, MatrixHeader::MAGIC, sizeof(hdr.magic))
+            || mapLen != sizeof(MatrixHeader) + hdr.N * hdr.N * sizeof(int)) {
+            errno = EINVAL;
+            return false;
+        }
+        // Start readahead of the whole matrix while the threads are being set up
+        madvise(mapAddr, mapLen, MADV_WILLNEED);
+        n = hdr.N;
+        base = (const int *)((const char *)mapAddr + sizeof(MatrixHeader));
+        return true;
+    }
+
+    /**
+     * @brief Mutable pointer to the owned elements, for filling them in.
+     * @return Pointer to the first element.
+     */
+    int *data() { return storage.data(); }
+
+    /**
+     * @brief Access a row of the matrix.
+     * @param i Row index.
+     * @return View over the N elements of row i.
+     */
+    std::span<const int> operator[](uint64_t i) const { return {base + i * n, n}; }
+};
+
 // Global variables
 
 uint64_t N, S, K, rowInc;
-std::vector<std::vector<int>> A;
+Matrix A;
 /// @brief Array of ThreadInfo structs for collection and output of results
 std::vector<ThreadInfo> threadInfos;
 /// @brief Counter for dynamic methods only
@@ -80,12 +353,15 @@ Counter<uint64_t> counter(0);
  */
 void *pthreads_chunkRunner(void *arg) {
     ThreadInfo *thInfo = (ThreadInfo *)arg;
+    PerfScope perf(thInfo->perf);
+    uint64_t res = 0;
     // Remaining i.e., N % K rows are to be given to first N % K threads.
     // Find starting row as id * (N / K) + min(id, N % K);
     uint64_t l = thInfo->id * (N / K) + std::min(thInfo->id, N % K);
     for (uint64_t i = l; i < std::min(N, l + N / K + (thInfo->id < N % K)); i++) {
-        for (auto &u : A[i]) thInfo->res += !u;
+        for (auto &u : A[i]) res += !u;
     }
+    thInfo->res = res;
     return NULL;
 }
 
@@ -96,9 +372,12 @@ void *pthreads_chunkRunner(void *arg) {
  */
 void *pthreads_mixedRunner(void *arg) {
     ThreadInfo *thInfo = (ThreadInfo *)arg;
+    PerfScope perf(thInfo->perf);
+    uint64_t res = 0;
     for (uint64_t i = thInfo->id; i < N; i += K) {
-        for (auto &u : A[i]) thInfo->res += !u;
+        for (auto &u : A[i]) res += !u;
     }
+    thInfo->res = res;
     return NULL;
 }
 
@@ -109,28 +388,82 @@ void *pthreads_mixedRunner(void *arg) {
  */
 void *pthreads_dynamicRunner(void *arg) {
     ThreadInfo *thInfo = (ThreadInfo *)arg;
+    PerfScope perf(thInfo->perf);
+    uint64_t res = 0;
+    ChunkSizer sizer(N, rowInc, K);
     // Attempt to get a new row
     while (counter.get() < N) {
-        // Acquire row and increment
-        uint64_t r = counter.getAndIncrement(rowInc);
-        for (uint64_t i = r; i < std::min(r + rowInc, N); i++) {
-            for (auto &u : A[i]) thInfo->res += !u;
+        // Acquire rows and increment
+        uint64_t r = sizer.claim(counter);
+        for (uint64_t i = r; i < sizer.end(); i++) {
+            for (auto &u : A[i]) res += !u;
         }
+        sizer.done();
     } 
+    thInfo->res = res;
     return NULL;
 }
 
 // OpenMP runners
 
+/*
+ * Every thread accumulates its zeros in a local variable, and stores it into
+ * its padded ThreadInfo once after its share of the loop. The reduction
+ * variants leave combining the per-thread sums to OpenMP instead.
+ */
+
+/// @brief Total number of zeros, for the reduction variants only
+uint64_t reductionTotal;
+
+/*
+ * The dynamic runners use the runtime schedule, set up by setDynamicSchedule()
+ * to match the grain. OpenMP has no adaptive schedule, so with the adaptive
+ * grain they claim rows from the shared counter themselves.
+ */
+
+/**
+ * @brief Set the OpenMP runtime schedule used by the dynamic technique: chunks
+ * of `rowInc` rows for the fixed grain, and guided chunks otherwise.
+ */
+void setDynamicSchedule() {
+    if (ChunkSizer::grain == ChunkSizer::FIXED) omp_set_schedule(omp_sched_dynamic, rowInc);
+    else omp_set_schedule(omp_sched_guided, 1);
+}
+
+/**
+ * @brief Count the zeros in the rows claimed by the calling thread with the
+ * adaptive grain.
+ * @return Number of zeros counted.
+ */
+uint64_t adaptiveRows() {
+    uint64_t res = 0;
+    ChunkSizer sizer(N, rowInc, omp_get_num_threads());
+    while (counter.get() < N) {
+        uint64_t r = sizer.claim(counter);
+        for (uint64_t i = r; i < sizer.end(); i++) {
+            for (auto &u : A[i]) res += !u;
+        }
+        sizer.done();
+    }
+    return res;
+}
+
 /**
  * @brief OpenMP runner function for chunk technique.
  * @param arg Unused.
  * @return Populated result in `thInfo`.
  */
 void *omp_chunkRunner(void *arg) {
-    #pragma omp parallel for schedule(static)
-    for (uint64_t i = 0; i < N; i++) {
-        for (auto &u : A[i]) threadInfos[omp_get_thread_num()].res += !u;
+    #pragma omp parallel
+    {
+        ThreadInfo &thInfo = threadInfos[omp_get_thread_num()];
+        PerfScope perf(thInfo.perf);
+        uint64_t res = 0;
+        #pragma omp for schedule(static) nowait
+        for (uint64_t i = 0; i < N; i++) {
+            for (auto &u : A[i]) res += !u;
+        }
+        thInfo.res = res;
     }
     return NULL;
 }
@@ -141,9 +474,16 @@ void *omp_chunkRunner(void *arg) {
  * @return Populated result in `thInfo`.
  */
 void *omp_mixedRunner(void *arg) {
-    #pragma omp parallel for schedule(static, 1)
-    for (uint64_t i = 0; i < N; i++) {
-        for (auto &u : A[i]) threadInfos[omp_get_thread_num()].res += !u;
+    #pragma omp parallel
+    {
+        ThreadInfo &thInfo = threadInfos[omp_get_thread_num()];
+        PerfScope perf(thInfo.perf);
+        uint64_t res = 0;
+        #pragma omp for schedule(static, 1) nowait
+        for (uint64_t i = 0; i < N; i++) {
+            for (auto &u : A[i]) res += !u;
+        }
+        thInfo.res = res;
     }
     return NULL;
 }
@@ -154,20 +494,269 @@ void *omp_mixedRunner(void *arg) {
  * @return Populated result in `thInfo`.
  */
 void *omp_dynamicRunner(void *arg) {
-    #pragma omp parallel for schedule(dynamic, K)
-    for (uint64_t i = 0; i < N; i++) {
-        assert(threadInfos.size() == K);
-        for (auto &u : A[i]) threadInfos[omp_get_thread_num()].res += !u;
+    assert(threadInfos.size() == K);
+    #pragma omp parallel
+    {
+        ThreadInfo &thInfo = threadInfos[omp_get_thread_num()];
+        PerfScope perf(thInfo.perf);
+        uint64_t res = 0;
+        if (ChunkSizer::grain == ChunkSizer::ADAPTIVE) {
+            res = adaptiveRows();
+        } else {
+            #pragma omp for schedule(runtime) nowait
+            for (uint64_t i = 0; i < N; i++) {
+                for (auto &u : A[i]) res += !u;
+            }
+        }
+        thInfo.res = res;
+    }
+    return NULL;
+}
+
+/**
+ * @brief OpenMP runner function for chunk technique, using a reduction.
+ * @param arg Unused.
+ * @return Populated result in `reductionTotal`.
+ */
+void *omp_chunkReductionRunner(void *arg) {
+    uint64_t total = 0;
+    #pragma omp parallel reduction(+:total)
+    {
+        PerfScope perf(threadInfos[omp_get_thread_num()].perf);
+        #pragma omp for schedule(static) nowait
+        for (uint64_t i = 0; i < N; i++) {
+            for (auto &u : A[i]) total += !u;
+        }
+    }
+    reductionTotal = total;
+    return NULL;
+}
+
+/**
+ * @brief OpenMP runner function for mixed technique, using a reduction.
+ * @param arg Unused.
+ * @return Populated result in `reductionTotal`.
+ */
+void *omp_mixedReductionRunner(void *arg) {
+    uint64_t total = 0;
+    #pragma omp parallel reduction(+:total)
+    {
+        PerfScope perf(threadInfos[omp_get_thread_num()].perf);
+        #pragma omp for schedule(static, 1) nowait
+        for (uint64_t i = 0; i < N; i++) {
+            for (auto &u : A[i]) total += !u;
+        }
+    }
+    reductionTotal = total;
+    return NULL;
+}
+
+/**
+ * @brief OpenMP runner function for dynamic technique, using a reduction.
+ * @param arg Unused.
+ * @return Populated result in `reductionTotal`.
+ */
+void *omp_dynamicReductionRunner(void *arg) {
+    uint64_t total = 0;
+    #pragma omp parallel reduction(+:total)
+    {
+        PerfScope perf(threadInfos[omp_get_thread_num()].perf);
+        if (ChunkSizer::grain == ChunkSizer::ADAPTIVE) {
+            total += adaptiveRows();
+        } else {
+            #pragma omp for schedule(runtime) nowait
+            for (uint64_t i = 0; i < N; i++) {
+                for (auto &u : A[i]) total += !u;
+            }
+        }
+    }
+    reductionTotal = total;
+    return NULL;
+}
+
+// Coherence traffic measurement
+
+/*
+ * The packed probe counts the zeros the way the runners originally did, with
+ * every element incremented straight into a packed per-thread slot. It runs
+ * with the same library and the same split of rows as the padded run, so that
+ * the two runs differ in the layout of the per-thread results alone. Only run
+ * in perf mode.
+ */
+
+/**
+ * @brief Arguments of a thread of the pthreads packed probe.
+ */
+struct ProbeArgs {
+    uint64_t id;                            /// Thread id
+    const std::string *tech;                /// Technique whose split of rows is used
+    std::vector<PackedThreadInfo> *infos;   /// Packed per-thread slots
+    PerfCounts *counts;                     /// Hardware counters of the thread
+    uint64_t *stores;                       /// Stores to the slot of the thread
+    Counter<uint64_t> *ctr;                 /// Shared row counter, for dynamic only
+};
+
+/**
+ * @brief Pthreads runner function for the packed probe. Rows are split as by
+ * the pthreads runner of the technique being measured.
+ * @param arg Probe arguments of the thread.
+ * @return Populated counters and stores in `arg`.
+ */
+void *pthreads_packedProbeRunner(void *arg) {
+    ProbeArgs *pa = (ProbeArgs *)arg;
+    std::vector<PackedThreadInfo> &infos = *pa->infos;
+    uint64_t id = pa->id, rows = 0;
+    PerfScope perf(*pa->counts);
+    auto countRow = [&](uint64_t i) {
+        for (auto &u : A[i]) infos[id].res += !u;
+        rows++;
+    };
+    if (*pa->tech == "chunk") {
+        uint64_t l = id * (N / K) + std::min(id, N % K);
+        for (uint64_t i = l; i < std::min(N, l + N / K + (id < N % K)); i++) countRow(i);
+    } else if (*pa->tech == "mixed") {
+        for (uint64_t i = id; i < N; i += K) countRow(i);
+    } else {
+        ChunkSizer sizer(N, rowInc, K);
+        while (pa->ctr->get() < N) {
+            for (uint64_t i = sizer.claim(*pa->ctr); i < sizer.end(); i++) countRow(i);
+            sizer.done();
+        }
     }
+    *pa->stores = rows * N;
     return NULL;
 }
 
+/**
+ * @brief OpenMP runner function for the packed probe. Rows are scheduled by
+ * the OpenMP runtime schedule, which is set up to match the technique being
+ * measured.
+ * @param infos Packed per-thread slots.
+ * @param counts Populated with the hardware counters of each thread.
+ * @param stores Populated with the number of stores to the slot of each thread.
+ */
+void omp_packedProbe(std::vector<PackedThreadInfo> &infos, std::vector<PerfCounts> &counts,
+                     std::vector<uint64_t> &stores) {
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        PerfScope perf(counts[t]);
+        uint64_t rows = 0;
+        #pragma omp for schedule(runtime) nowait
+        for (uint64_t i = 0; i < N; i++) {
+            for (auto &u : A[i]) infos[omp_get_thread_num()].res += !u;
+            rows++;
+        }
+        stores[t] = rows * N;
+    }
+}
+
+/**
+ * @brief Run the packed probe with K threads of the given library.
+ * @param lib Library used by the padded run.
+ * @param tech Technique used by the padded run.
+ * @param infos Packed per-thread slots.
+ * @param counts Populated with the hardware counters of each thread.
+ * @param stores Populated with the number of stores to the slot of each thread.
+ */
+void packedProbe(const std::string &lib, const std::string &tech, std::vector<PackedThreadInfo> &infos,
+                 std::vector<PerfCounts> &counts, std::vector<uint64_t> &stores) {
+    if (lib == "pthreads") {
+        // The shared counter of the padded run is used up, so start a fresh one
+        Counter<uint64_t> ctr(0);
+        std::vector<ProbeArgs> args(K);
+        std::vector<pthread_t> threads(K);
+        for (uint64_t i = 0; i < K; i++) {
+            args[i] = {i, &tech, &infos, &counts[i], &stores[i], &ctr};
+            pthread_create(&threads[i], NULL, pthreads_packedProbeRunner, (void *)&args[i]);
+        }
+        for (uint64_t i = 0; i < K; i++) pthread_join(threads[i], NULL);
+    } else {
+        if (tech == "chunk") omp_set_schedule(omp_sched_static, 0);
+        else if (tech == "mixed") omp_set_schedule(omp_sched_static, 1);
+        else setDynamicSchedule();
+        omp_set_num_threads(K);
+        omp_packedProbe(infos, counts, stores);
+    }
+}
+
+/**
+ * @brief Count the stores to per-thread slots that land on a cache line also
+ * holding the slot of another thread. Each of them may pull the line away
+ * from the other thread.
+ * @param infos Per-thread slots.
+ * @param stores Number of stores to the slot of each thread.
+ * @return Number of stores to shared cache lines.
+ */
+template<class Info>
+uint64_t sharedLineStores(const std::vector<Info> &infos, const std::vector<uint64_t> &stores) {
+    uint64_t res = 0;
+    for (uint64_t t = 0; t < infos.size(); t++) {
+        uintptr_t line = (uintptr_t)&infos[t] / 64;
+        for (uint64_t u = 0; u < infos.size(); u++) {
+            if (u != t && (uintptr_t)&infos[u] / 64 == line) {
+                res += stores[t];
+                break;
+            }
+        }
+    }
+    return res;
+}
+
+// Hardware counter output
+
+/**
+ * @brief Write hardware counters as a JSON object. Counters that were not
+ * read are written as null.
+ * @param fp File to write to.
+ * @param c Counters to write.
+ */
+void writePerfCounts(FILE *fp, const PerfCounts &c) {
+    for (int e = 0; e < PerfCounts::NUM; e++) {
+        fprintf(fp, "%s\"%s\": ", e ? ", " : "", PerfCounts::NAMES[e]);
+        if (c.valid[e]) fprintf(fp, "%lu", c.value[e]);
+        else fprintf(fp, "null");
+    }
+}
+
+/**
+ * @brief Write the hardware counters of every thread, and their totals, as
+ * JSON.
+ * @param file Path of the JSON file to create.
+ * @param runner Name of the runner measured.
+ * @param ms Time taken by the runner in milliseconds.
+ * @return true on success, false (with errno set) on failure.
+ */
+bool writePerfJson(const char *file, const std::string &runner, uint64_t ms) {
+    FILE *fp = fopen(file, "w");
+    if (!fp) return false;
+    PerfCounts total;
+    fprintf(fp, "{\n  \"runner\": \"%s\",\n  \"N\": %lu,\n  \"K\": %lu,\n  \"time_ms\": %lu,\n",
+            runner.c_str(), N, K, ms);
+    fprintf(fp, "  \"error\": ");
+    if (PerfScope::error) fprintf(fp, "\"%s\",\n", std::strerror(PerfScope::error));
+    else fprintf(fp, "null,\n");
+    fprintf(fp, "  \"threads\": [\n");
+    for (auto &thInfo : threadInfos) {
+        fprintf(fp, "    {\"id\": %lu, ", thInfo.id);
+        writePerfCounts(fp, thInfo.perf);
+        fprintf(fp, "}%s\n", thInfo.id + 1 < threadInfos.size() ? "," : "");
+        total.add(thInfo.perf);
+    }
+    fprintf(fp, "  ],\n  \"total\": {");
+    writePerfCounts(fp, total);
+    fprintf(fp, "}\n}\n");
+    return fclose(fp) == 0;
+}
+
 // Constants
 
 /// @brief Input file
 const char* INFILE = "inp.txt";
 /// @brief Output file
 const char* OUTFILE = "out.txt";
+/// @brief Hardware counter file, for perf mode only
+const char* PERFFILE = "out.json";
 /// @brief Supported runners
 std::unordered_map<std::string, void *(*)(void *)> supportedRunners {
     {"pthreads_chunk", pthreads_chunkRunner},
@@ -176,8 +765,28 @@ std::unordered_map<std::string, void *(*)(void *)> supportedRunners {
     {"omp_chunk", omp_chunkRunner},
     {"omp_mixed", omp_mixedRunner},
     {"omp_dynamic", omp_dynamicRunner},
+    {"omp_chunk_reduction", omp_chunkReductionRunner},
+    {"omp_mixed_reduction", omp_mixedReductionRunner},
+    {"omp_dynamic_reduction", omp_dynamicReductionRunner},
 };
 
+/**
+ * @brief Write the matrix along with the input parameters in binary format.
+ * @param file Path of the binary matrix file to create.
+ * @return true on success, false (with errno set) on failure.
+ */
+bool writeBinary(const char *file) {
+    MatrixHeader hdr{};
+    std::memcpy(hdr.magic, MatrixHeader::MAGIC, sizeof(hdr.magic));
+    hdr.N = N, hdr.S = S, hdr.K = K, hdr.rowInc = rowInc;
+    FILE *fp = fopen(file, "wb");
+    if (!fp) return false;
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+    for (uint64_t i = 0; ok && i < N; i++)
+        ok = fwrite(A[i].data(), sizeof(int), N, fp) == N;
+    return fclose(fp) == 0 && ok;
+}
+
 /**
  * @brief Function to print program help.
  * @param name Name of executable, usually argv[0].
@@ -185,9 +794,15 @@ std::unordered_map<std::string, void *(*)(void *)> supportedRunners {
 void help(std::string name) {
     std::cerr << "Usage: " << name << " [options]\n\n"
               << "Options:\n"
-              << "  -h,--help                            Display this information\n"
-              << "  -t,--technique {chunk|mixed|dynamic} Use the specified technique for computation\n"
-              << "  -l,--library   {pthreads|omp}        Use the specified library for computation"
+              << "  -h,--help                              Display this information\n"
+              << "  -t,--technique {chunk|mixed|dynamic}   Use the specified technique for computation\n"
+              << "  -l,--library   {pthreads|omp}          Use the specified library for computation\n"
+              << "  -g,--grain     {fixed|guided|adaptive} Claim size of the dynamic technique (default: fixed)\n"
+              << "  -r,--reduction                         Combine the per-thread results with an OpenMP reduction\n"
+              << "  -P,--perf                              Record hardware counters of every thread in " << PERFFILE << ", and measure\n"
+              << "                                         the coherence traffic saved by padded per-thread results\n"
+              << "  -b,--binary    <FILE>                  Map the binary matrix FILE instead of reading " << INFILE << "\n"
+              << "  -c,--convert   <FILE>                  Convert " << INFILE << " to the binary matrix FILE and exit"
               << std::endl;
 }
 
@@ -199,6 +814,9 @@ int main(int argc, char* argv[]) {
     }
     // Runner function to use in threads
     std::string tech = "", lib = "";
+    // Binary matrix files to read from or convert to
+    const char *binFile = NULL, *convFile = NULL;
+    bool reduction = false;
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
         if (arg == "-h" || arg == "--help") {
@@ -210,35 +828,74 @@ int main(int argc, char* argv[]) {
         } else if (arg == "-l" || arg == "--library") {
             i++;
             lib = argv[i];
+        } else if (arg == "-g" || arg == "--grain") {
+            i++;
+            std::string grain = argv[i];
+            if (grain == "fixed") ChunkSizer::grain = ChunkSizer::FIXED;
+            else if (grain == "guided") ChunkSizer::grain = ChunkSizer::GUIDED;
+            else if (grain == "adaptive") ChunkSizer::grain = ChunkSizer::ADAPTIVE;
+            else {
+                help(argv[0]);
+                return 1;
+            }
+        } else if (arg == "-r" || arg == "--reduction") {
+            reduction = true;
+        } else if (arg == "-P" || arg == "--perf") {
+            PerfScope::enabled = true;
+        } else if (arg == "-b" || arg == "--binary") {
+            i++;
+            binFile = argv[i];
+        } else if (arg == "-c" || arg == "--convert") {
+            i++;
+            convFile = argv[i];
         } else {
             help(argv[0]);
             return 1;
         }
     }
     // Validate input args
-    std::string fn = lib + "_" + tech;
-    if (supportedRunners.find(fn) == supportedRunners.end()) {
+    std::string fn = lib + "_" + tech + (reduction ? "_reduction" : "");
+    if (!convFile && supportedRunners.find(fn) == supportedRunners.end()) {
         std::cerr << "[ERROR] Unsupported runner " << fn << std::endl;
         return 1;
     }
     // Setup input and output filestreams
     std::cin.tie(0)->sync_with_stdio(0);
-    if (!freopen(INFILE, "r", stdin)) {
-        std::cerr << "[ERROR] Opening input file " << INFILE << " failed: " 
-                  << std::strerror(errno) << std::endl;
-        return 1;
+    if (binFile) {
+        // Read inputs straight off the mapped pages
+        MatrixHeader hdr;
+        if (!A.map(binFile, hdr)) {
+            std::cerr << "[ERROR] Mapping binary matrix file " << binFile << " failed: "
+                      << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        N = hdr.N, S = hdr.S, K = hdr.K, rowInc = hdr.rowInc;
+    } else {
+        if (!freopen(INFILE, "r", stdin)) {
+            std::cerr << "[ERROR] Opening input file " << INFILE << " failed: " 
+                      << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        // Read inputs
+        std::cin >> N >> S >> K >> rowInc;
+        A.assign(N);
+        for (int *v = A.data(), *e = v + N * N; v != e; v++) std::cin >> *v;
+    }
+    if (convFile) {
+        if (!writeBinary(convFile)) {
+            std::cerr << "[ERROR] Writing binary matrix file " << convFile << " failed: "
+                      << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        return 0;
     }
     if (!freopen(OUTFILE, "w", stdout)) {
         std::cerr << "[ERROR] Opening output file " << OUTFILE << " failed: " 
                   << std::strerror(errno) << std::endl;
         return 1;
     }
-    // Read inputs
-    std::cin >> N >> S >> K >> rowInc;
-    A.assign(N, std::vector<int> (N));
-    for (auto &u : A) for (auto &v : u) std::cin >> v;
     threadInfos.assign(K, {});
-    for (uint64_t i = 0; i < K; i++) threadInfos[i] = {i, 0};
+    for (uint64_t i = 0; i < K; i++) threadInfos[i] = {i, 0, {}};
     // Set up runner function
     void *(*runner) (void *) = supportedRunners[fn];
     // Start timer
@@ -251,6 +908,7 @@ int main(int argc, char* argv[]) {
     } else if (lib == "omp") {
         // Set number of threads
         omp_set_num_threads(K);
+        setDynamicSchedule();
         // Call runner
         runner(NULL);
     }
@@ -259,11 +917,41 @@ int main(int argc, char* argv[]) {
     auto tm = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
     // Collect and output statistics
     std::cout << "Time taken to count the number of zeros: " << tm.count() << " ms\n";
-    int sm = 0;
+    uint64_t sm = 0;
     for (auto &thInfo : threadInfos) sm += thInfo.res;
+    // Per-thread results are not kept by the reduction variants
+    if (reduction) sm = reductionTotal;
     std::cout << "Total number of zero-valued elements in the matrix: " << sm << '\n';
-    for (auto &thInfo : threadInfos) 
-        std::cout << "Number of zero-valued elements counted by thread" 
-                  << thInfo.id << ": " << thInfo.res << '\n';
+    if (!reduction)
+        for (auto &thInfo : threadInfos) 
+            std::cout << "Number of zero-valued elements counted by thread" 
+                      << thInfo.id << ": " << thInfo.res << '\n';
+    if (PerfScope::enabled && !writePerfJson(PERFFILE, fn, tm.count())) {
+        std::cerr << "[ERROR] Writing hardware counter file " << PERFFILE << " failed: "
+                  << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    if (PerfScope::enabled) {
+        // Redo the count with the original packed slots and per-element stores
+        std::vector<PackedThreadInfo> packedInfos(K);
+        std::vector<PerfCounts> packedCounts(K);
+        std::vector<uint64_t> packedStores(K), stores(K, reduction ? 0 : 1);
+        for (uint64_t i = 0; i < K; i++) packedInfos[i] = {i, 0};
+        packedProbe(lib, tech, packedInfos, packedCounts, packedStores);
+        PerfCounts padded, packed;
+        for (uint64_t i = 0; i < K; i++) padded.add(threadInfos[i].perf), packed.add(packedCounts[i]);
+        uint64_t misses = padded.value[PerfCounts::L1D_MISSES], oldMisses = packed.value[PerfCounts::L1D_MISSES];
+        if (!padded.valid[PerfCounts::L1D_MISSES]) {
+            std::cout << "L1D misses: unavailable (" << std::strerror(PerfScope::error) << ")\n";
+        } else {
+            std::cout << "L1D misses with padded per-thread results: " << misses << '\n'
+                      << "L1D misses with packed per-thread results: " << oldMisses << '\n'
+                      << "L1D misses saved: " << (int64_t)(oldMisses - misses) << '\n';
+        }
+        std::cout << "Stores to cache lines shared with other threads with padded per-thread results: "
+                  << sharedLineStores(threadInfos, stores) << '\n'
+                  << "Stores to cache lines shared with other threads with packed per-thread results: "
+                  << sharedLineStores(packedInfos, packedStores) << '\n';
+    }
     return 0;
 }
\ No newline at end of file
@@ -18,6 +18,8 @@
 #include <string>
 #include <random>
 #include <thread>
+#include <atomic>
+#include "harness.hpp"
 
 // Classes and structs
 
@@ -63,85 +65,82 @@ public:
     }
 };
 
-// Global variables
-int n, k;
-double lambda_1, lambda_2;
-std::exponential_distribution exp_dist_1, exp_dist_2;
-std::mt19937 gen;
-std::chrono::time_point<std::chrono::system_clock> start;
-
-// Constants
+/**
+ * @class PaddedBakeryLock
+ * @brief Production version of BakeryLock, following Lamport's original
+ * algorithm. The flag and label of each thread are atomics on a cache line of
+ * their own. Labels are 32 bits wide and wrap around: a label of 0 means the
+ * thread is not interested, and the others are compared in serial number
+ * arithmetic. This is sound as the labels of interested threads span at most
+ * 2n values, far less than 2^31. Waiting threads wait through the policy Wait
+ * of wait.hpp, and are signalled whenever a thread chooses or drops its label.
+ */
+template<class Wait>
+class PaddedBakeryLock {
+private:
+    /**
+     * @brief Slots of a thread, on a cache line of their own.
+     */
+    struct alignas(64) Slot {
+        std::atomic<bool> flag = false;     /// Whether the thread is choosing its label
+        std::atomic<uint32_t> label = 0;    /// Label of the thread, 0 if not interested
+    };
 
-/// @brief Input file
-const char *INFILE = "inp-params.txt";
-/// @brief Output file
-const char *OUTFILE = "out.txt";
+    size_t n;                           /// Number of threads
+    std::vector<Slot> slots;            /// Slots of each thread
+    alignas(64) WaitWord changed;       /// Signalled after every label chosen or dropped
 
-// Runner functions
+    /**
+     * @brief Whether label a comes before label b, with wrapping.
+     */
+    static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+public:
+    /**
+     * @brief Constructor method for PaddedBakeryLock
+     * @param N Number of threads
+     */
+    PaddedBakeryLock(size_t _n) : n(_n), slots(n) {}
 
-void testCS(int id, BakeryLock &lock, std::stringstream &log) {
-    for (int i = 0; i < k; i++) {
-        // Log CS entry request
-        log << "CS Entry Request " << i + 1 << " at "
-        << (std::chrono::system_clock::now() - start).count()
-        << " ns by thread " << id + 1 << '\n';
-        // Acquire lock
-        lock.lock(id);
-        // Log CS entry
-        log << "CS Entry " << i + 1 << " at "
-        << (std::chrono::system_clock::now() - start).count()
-        << " ns by thread " << id + 1 << '\n';
-        // Sleep in CS
-        std::this_thread::sleep_for(std::chrono::milliseconds((int)exp_dist_1(gen)));
-        // Log CS exit request
-        log << "CS Exit Request " << i + 1 << " at "
-        << (std::chrono::system_clock::now() - start).count()
-        << " ns by thread " << id + 1 << '\n';
-        // Release lock
-        lock.unlock(id);
-        // Log CS exit
-        log << "CS Exit " << i + 1 << " at "
-        << (std::chrono::system_clock::now() - start).count()
-        << " ns by thread " << id + 1 << '\n';
-        // Wait before next entry
-        std::this_thread::sleep_for(std::chrono::milliseconds((int)exp_dist_2(gen)));
+    /**
+     * @brief Method to acquire PaddedBakeryLock
+     * @param id Thread ID
+     */
+    void lock(int id) {
+        // The doorway orders stores before loads of other slots, which only
+        // sequential consistency provides; on x86 this costs one locked store
+        slots[id].flag.store(true);
+        uint32_t mx = 0;
+        for (size_t i = 0; i < n; i++) {
+            uint32_t l = slots[i].label.load();
+            if (l && (!mx || before(mx, l))) mx = l;
+        }
+        uint32_t mine = mx + 1 ? mx + 1 : 1;
+        slots[id].label.store(mine);
+        slots[id].flag.store(false);
+        Wait::wake(changed);
+        for (int i = 0; i < (int)n; i++) {
+            if (i == id) continue;
+            // Wait for thread i to choose its label, then for it to go first
+            Wait::wait(changed, [&] { return !slots[i].flag.load(); });
+            Wait::wait(changed, [&] {
+                uint32_t l = slots[i].label.load();
+                return !l || before(mine, l) || (l == mine && id < i);
+            });
+        }
     }
-}
 
-int main() {
-    // Set up file IO streams
-    std::fstream fin(INFILE, std::fstream::in), fout(OUTFILE, std::fstream::out);
-    // Ensure the filestreams are created
-    if (!fin) {
-        std::cout << "[ERROR] Input file " << INFILE << " not found.\n";
-        return 1;
-    }
-    if (!fout) {
-        std::cout << "[ERROR] Output file " << OUTFILE << " not created.\n";
-        return 1;
+    /**
+     * @brief Method to release PaddedBakeryLock
+     * @param id Thread ID
+     */
+    void unlock(int id) {
+        slots[id].label.store(0, std::memory_order_release);
+        Wait::wake(changed);
     }
-    // Read parameters
-    fin >> n >> k >> lambda_1 >> lambda_2;
-    // Set up distributions and random number generator
-    exp_dist_1 = std::exponential_distribution(lambda_1);
-    exp_dist_2 = std::exponential_distribution(lambda_2);
-    gen = std::mt19937(std::chrono::system_clock::now().time_since_epoch().count());
-    // Set up logging
-    std::vector<std::stringstream> thread_logs(n); 
-    // Set up lock
-    BakeryLock lock(n);
-    std::vector<std::thread> runner_threads(n);
-    // Start timer
-    start = std::chrono::system_clock::now();
-    // Create threads
-    for (int i = 0; i < n; i++) runner_threads[i] = std::thread(testCS, i, std::ref(lock), std::ref(thread_logs[i]));
-    // Join threads
-    for (int i = 0; i < n; i++) runner_threads[i].join();
-    // End timer
-    auto end = std::chrono::system_clock::now();
-    // Write to output file
-    for (auto &ss : thread_logs) fout << ss.str();
-    // Write program end log
-    fout << "Program ended at " << (end - start).count() << " ns\n";
-    return 0;
-}
\ No newline at end of file
+};
+
+int main(int argc, char *argv[]) {
+    std::vector<LockEntry> locks = policies<PaddedBakeryLock>("PaddedBakeryLock");
+    locks.push_back(entry<BakeryLock>("original", "BakeryLock"));
+    return lockMain(argc, argv, locks);
+}
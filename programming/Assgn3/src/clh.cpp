@@ -0,0 +1,98 @@
+/**
+ * @author Gautam Singh
+ * @file CLH-CS21BTECH11018.cpp
+ * @brief C++ source for implementing the CLH Lock and testing it on a
+ * multithreaded application. In this application, critical section and waiting
+ * for each thread are simulated by exponential delays, with their own averages. 
+ *
+ * @date 2024-09-16
+ */
+
+// Headers
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <utility>
+#include <string>
+#include <random>
+#include <thread>
+#include <atomic>
+#include "harness.hpp"
+
+// Classes and structs
+
+/**
+ * @class CLHLock
+ * @brief An implementation of the CLH queue lock. Threads append their own
+ * queue node to a shared tail, and spin on the flag in the node of their
+ * predecessor until it releases the lock. A releasing thread takes over the
+ * node of its predecessor for its next acquisition. Each node sits on its own
+ * cache line, so every waiter spins on a line no other waiter touches. Waiting
+ * threads wait through the policy Wait of wait.hpp, on the wait word of the
+ * node they spin on.
+ */
+template<class Wait>
+class CLHLock {
+private:
+    /**
+     * @brief Queue node, owned by one thread at a time.
+     */
+    struct alignas(64) QNode {
+        std::atomic<bool> locked = false;   /// Whether the owner holds or wants the lock
+        WaitWord release;                   /// Signalled when the owner releases the lock
+    };
+
+    /**
+     * @brief Nodes a thread is using.
+     */
+    struct alignas(64) ThreadNodes {
+        QNode *node;    /// Node of the thread
+        QNode *pred;    /// Node of its predecessor in the queue
+    };
+
+    size_t n;                           /// Number of threads
+    std::vector<QNode> nodes;           /// Queue nodes, one more than threads
+    std::vector<ThreadNodes> mine;      /// Nodes of each thread
+    alignas(64) std::atomic<QNode *> tail;  /// Last node in the queue
+public:
+    /**
+     * @brief Constructor method for CLHLock
+     * @param N Number of threads
+     */
+    CLHLock(size_t _n) : n(_n), nodes(n + 1), mine(n), tail(&nodes[n]) {
+        for (size_t i = 0; i < n; i++) mine[i] = {&nodes[i], nullptr};
+    }
+
+    /**
+     * @brief Method to acquire CLHLock
+     * @param id Thread ID
+     */
+    void lock(int id) {
+        ThreadNodes &t = mine[id];
+        t.node->locked.store(true, std::memory_order_relaxed);
+        // Join the queue, and wait for the predecessor to release
+        t.pred = tail.exchange(t.node, std::memory_order_acq_rel);
+        QNode *pred = t.pred;
+        Wait::wait(pred->release, [&] { return !pred->locked.load(std::memory_order_acquire); });
+    }
+
+    /**
+     * @brief Method to release CLHLock
+     * @param id Thread ID
+     */
+    void unlock(int id) {
+        ThreadNodes &t = mine[id];
+        QNode *node = t.node;
+        // The predecessor's node is free now, so reuse it next time
+        t.node = t.pred;
+        node->locked.store(false, std::memory_order_release);
+        Wait::wake(node->release);
+    }
+};
+
+int main(int argc, char *argv[]) {
+    std::vector<LockEntry> locks = policies<CLHLock>("CLHLock");
+    return lockMain(argc, argv, locks);
+}
@@ -0,0 +1,134 @@
+/**
+ * @author Gautam Singh
+ * @file Cohort-CS21BTECH11018.cpp
+ * @brief C++ source for implementing a NUMA-aware cohort lock and testing it on
+ * a multithreaded application. In this application, critical section and
+ * waiting for each thread are simulated by exponential delays, with their own
+ * averages.
+ *
+ * @date 2026-10-17
+ */
+
+// Headers
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <utility>
+#include <string>
+#include <random>
+#include <thread>
+#include <atomic>
+#include "harness.hpp"
+
+// Classes and structs
+
+/**
+ * @class TicketLock
+ * @brief A ticket lock, which any thread may release and which tells whether
+ * threads are waiting for it. Waiting threads wait through the policy Wait of
+ * wait.hpp.
+ */
+template<class Wait>
+class TicketLock {
+private:
+    alignas(64) std::atomic<uint32_t> next = 0;     /// Next ticket
+    alignas(64) std::atomic<uint32_t> serving = 0;  /// Ticket of the thread allowed in
+    alignas(64) WaitWord changed;                   /// Signalled after every release
+public:
+    /**
+     * @brief Method to acquire TicketLock
+     */
+    void lock() {
+        uint32_t ticket = next.fetch_add(1, std::memory_order_relaxed);
+        Wait::wait(changed, [&] { return serving.load(std::memory_order_acquire) == ticket; });
+    }
+
+    /**
+     * @brief Method to release TicketLock
+     */
+    void unlock() {
+        serving.store(serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        Wait::wake(changed);
+    }
+
+    /**
+     * @brief Whether threads are waiting for TicketLock, called by its holder
+     */
+    bool waiting() const {
+        return next.load(std::memory_order_relaxed) - serving.load(std::memory_order_relaxed) > 1;
+    }
+};
+
+/**
+ * @class CohortLock
+ * @brief A cohort lock. Threads first acquire the lock of their socket, and
+ * only the first thread of a cohort acquires the global lock. A releasing
+ * thread with waiters on its socket hands the global lock over to them with
+ * the socket lock, so the data of the critical section stays in the caches of
+ * one socket, up to MAX_PASSES times in a row so that other sockets are not
+ * starved. Sockets come from the placement of the threads of topology.hpp.
+ */
+template<class Wait>
+class CohortLock {
+private:
+    static constexpr uint32_t MAX_PASSES = 64;  /// Handoffs within a socket before releasing the global lock
+
+    /**
+     * @brief Cohort of the threads of a socket.
+     */
+    struct Cohort {
+        TicketLock<Wait> local;     /// Lock of the socket
+        bool global = false;        /// Whether the cohort holds the global lock, guarded by local
+        uint32_t passes = 0;        /// Handoffs within the cohort in a row, guarded by local
+    };
+
+    size_t n;                       /// Number of threads
+    std::vector<int> socket;        /// Socket of each thread
+    std::vector<Cohort> cohorts;    /// Cohort of each socket
+    TicketLock<Wait> global;        /// Global lock
+public:
+    /**
+     * @brief Constructor method for CohortLock
+     * @param N Number of threads
+     */
+    CohortLock(size_t _n) : n(_n), socket(n), cohorts(numSockets()) {
+        for (size_t i = 0; i < n; i++) socket[i] = threadSocket(i);
+    }
+
+    /**
+     * @brief Method to acquire CohortLock
+     * @param id Thread ID
+     */
+    void lock(int id) {
+        Cohort &c = cohorts[socket[id]];
+        c.local.lock();
+        // The global lock may have been handed over with the socket lock
+        if (!c.global) {
+            global.lock();
+            c.global = true;
+        }
+    }
+
+    /**
+     * @brief Method to release CohortLock
+     * @param id Thread ID
+     */
+    void unlock(int id) {
+        Cohort &c = cohorts[socket[id]];
+        if (c.local.waiting() && ++c.passes < MAX_PASSES) {
+            c.local.unlock();
+            return;
+        }
+        c.passes = 0;
+        c.global = false;
+        global.unlock();
+        c.local.unlock();
+    }
+};
+
+int main(int argc, char *argv[]) {
+    std::vector<LockEntry> locks = policies<CohortLock>("CohortLock");
+    return lockMain(argc, argv, locks);
+}
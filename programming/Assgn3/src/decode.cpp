@@ -0,0 +1,91 @@
+/**
+ * @author Gautam Singh
+ * @file decode.cpp
+ * @brief Offline decoder of the trace files written by the locks. Reports the
+ * distribution of the time threads waited to enter the critical section for
+ * every trace, and optionally writes the text log of a trace.
+ *
+ * @date 2026-10-17
+ */
+
+// Headers
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include "trace.hpp"
+
+/**
+ * @brief Write the distribution of the wait times of a trace: percentiles, and
+ * the number of waits in each power of two of nanoseconds.
+ * @param hdr Header of the trace
+ * @param waits Wait times in nanoseconds
+ */
+void report(const TraceHeader &hdr, std::vector<uint64_t> waits) {
+    std::cout << hdr.lock << ", n = " << hdr.n << ", k = " << hdr.k << ": " << waits.size() << " entries\n";
+    if (waits.empty()) return;
+    std::sort(waits.begin(), waits.end());
+    double mean = 0;
+    for (uint64_t w : waits) mean += (double)w / waits.size();
+    auto pct = [&](double p) { return waits[std::min<uint64_t>(waits.size() - 1, (uint64_t)(p * waits.size()))]; };
+    std::cout << std::fixed << std::setprecision(3)
+              << "  mean " << mean / 1e3 << " us, min " << waits.front() / 1e3 << " us, p50 " << pct(0.5) / 1e3
+              << " us, p90 " << pct(0.9) / 1e3 << " us, p99 " << pct(0.99) / 1e3 << " us, p99.9 " << pct(0.999) / 1e3
+              << " us, max " << waits.back() / 1e3 << " us\n";
+    std::vector<uint64_t> buckets(65);
+    for (uint64_t w : waits) buckets[w ? 64 - __builtin_clzll(w) : 0]++;
+    for (int b = 0; b < 65; b++)
+        if (buckets[b]) std::cout << "  [" << (b ? 1ull << (b - 1) : 0) << ", " << (b ? (b < 64 ? 1ull << b : ~0ull) : 1)
+                                  << ") ns: " << buckets[b] << '\n';
+}
+
+/**
+ * @brief Function to print program help.
+ * @param name Name of executable, usually argv[0]
+ */
+void help(std::string name) {
+    std::cout << "Usage: " << name << " [options] <TRACE>...\n\n"
+              << "Options:\n"
+              << "  -l,--log <FILE>  Write the text log of the first trace to FILE\n";
+}
+
+int main(int argc, char *argv[]) {
+    // Parse options
+    const char *logFile = NULL;
+    std::vector<const char *> traces;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-l" || arg == "--log") && i + 1 < argc) {
+            logFile = argv[++i];
+        } else if (arg[0] == '-') {
+            help(argv[0]);
+            return 1;
+        } else {
+            traces.push_back(argv[i]);
+        }
+    }
+    if (traces.empty()) {
+        help(argv[0]);
+        return 1;
+    }
+    for (size_t t = 0; t < traces.size(); t++) {
+        TraceHeader hdr;
+        std::vector<TraceRecord> records;
+        if (!readTrace(traces[t], hdr, records)) {
+            std::cout << "[ERROR] Trace file " << traces[t] << " not readable.\n";
+            return 1;
+        }
+        if (!t && logFile) {
+            std::fstream fout(logFile, std::fstream::out);
+            if (!fout) {
+                std::cout << "[ERROR] Output file " << logFile << " not created.\n";
+                return 1;
+            }
+            writeLog(hdr, records, fout);
+        }
+        report(hdr, waitTimes(hdr, records));
+    }
+    return 0;
+}
@@ -18,6 +18,8 @@
 #include <string>
 #include <random>
 #include <thread>
+#include <atomic>
+#include "harness.hpp"
 
 // Classes and structs
 
@@ -63,85 +65,74 @@ public:
     }
 };
 
-// Global variables
-int n, k;
-double lambda_1, lambda_2;
-std::exponential_distribution exp_dist_1, exp_dist_2;
-std::mt19937 gen;
-std::chrono::time_point<std::chrono::system_clock> start;
-
-// Constants
-
-/// @brief Input file
-const char *INFILE = "inp-params.txt";
-/// @brief Output file
-const char *OUTFILE = "out.txt";
-
-// Runner functions
+/**
+ * @class PaddedFilterLock
+ * @brief Production version of FilterLock. The level of each thread and the
+ * victim of each level are atomics on cache lines of their own, so spinning
+ * threads are neither hoisted out of their loops by the optimizer nor slowed
+ * down by writes to unrelated slots. Waiting threads wait through the policy
+ * Wait of wait.hpp, and are signalled whenever a level or a victim changes.
+ */
+template<class Wait>
+class PaddedFilterLock {
+private:
+    /**
+     * @brief Atomic slot on a cache line of its own.
+     */
+    struct alignas(64) Slot {
+        std::atomic<int> value;     /// Value of the slot
+    };
 
-void testCS(int id, FilterLock &lock, std::stringstream &log) {
-    for (int i = 0; i < k; i++) {
-        // Log CS entry request
-        log << "CS Entry Request " << i + 1 << " at "
-        << (std::chrono::system_clock::now() - start).count()
-        << " ns by thread " << id + 1 << '\n';
-        // Acquire lock
-        lock.lock(id);
-        // Log CS entry
-        log << "CS Entry " << i + 1 << " at "
-        << (std::chrono::system_clock::now() - start).count()
-        << " ns by thread " << id + 1 << '\n';
-        // Sleep in CS
-        std::this_thread::sleep_for(std::chrono::milliseconds((int)exp_dist_1(gen)));
-        // Log CS exit request
-        log << "CS Exit Request " << i + 1 << " at "
-        << (std::chrono::system_clock::now() - start).count()
-        << " ns by thread " << id + 1 << '\n';
-        // Release lock
-        lock.unlock(id);
-        // Log CS exit
-        log << "CS Exit " << i + 1 << " at "
-        << (std::chrono::system_clock::now() - start).count()
-        << " ns by thread " << id + 1 << '\n';
-        // Wait before next entry
-        std::this_thread::sleep_for(std::chrono::milliseconds((int)exp_dist_2(gen)));
+    size_t n;                       /// Number of threads
+    std::vector<Slot> level;        /// Level of each thread
+    std::vector<Slot> victim;       /// Victim at each level
+    alignas(64) WaitWord changed;   /// Signalled after every change of a slot
+public:
+    /**
+     * @brief Constructor method for PaddedFilterLock
+     * @param N Number of threads
+     */
+    PaddedFilterLock(size_t _n) : n(_n), level(n), victim(n) {
+        for (size_t i = 0; i < n; i++) level[i].value = 0, victim[i].value = -1;
     }
-}
 
-int main() {
-    // Set up file IO streams
-    std::fstream fin(INFILE, std::fstream::in), fout(OUTFILE, std::fstream::out);
-    // Ensure the filestreams are created
-    if (!fin) {
-        std::cout << "[ERROR] Input file " << INFILE << " not found.\n";
-        return 1;
+    /**
+     * @brief Method to acquire PaddedFilterLock
+     * @param id Thread ID
+     */
+    void lock(int id) {
+        for (int i = 1; i < (int)n; i++) {  // Attempt to enter level i
+            level[id].value.store(i, std::memory_order_relaxed);
+            // The exchanges on victim[i] are totally ordered, and each one
+            // acquires the levels stored before all earlier ones. So the last
+            // victim sees every other thread at level i, which is the ordering
+            // the textbook lock gets from sequential consistency.
+            victim[i].value.exchange(id, std::memory_order_acq_rel);
+            // A new victim releases the previous one
+            Wait::wake(changed);
+            // Waiting condition
+            for (int j = 0; j < (int)n; j++) {
+                if (j == id) continue;
+                Wait::wait(changed, [&] {
+                    return level[j].value.load(std::memory_order_acquire) < i
+                           || victim[i].value.load(std::memory_order_acquire) != id;
+                });
+            }
+        }
     }
-    if (!fout) {
-        std::cout << "[ERROR] Output file " << OUTFILE << " not created.\n";
-        return 1;
+
+    /**
+     * @brief Method to release PaddedFilterLock
+     * @param id Thread ID
+     */
+    void unlock(int id) {
+        level[id].value.store(0, std::memory_order_release);
+        Wait::wake(changed);
     }
-    // Read parameters
-    fin >> n >> k >> lambda_1 >> lambda_2;
-    // Set up distributions and random number generator
-    exp_dist_1 = std::exponential_distribution(lambda_1);
-    exp_dist_2 = std::exponential_distribution(lambda_2);
-    gen = std::mt19937(std::chrono::system_clock::now().time_since_epoch().count());
-    // Set up logging
-    std::vector<std::stringstream> thread_logs(n); 
-    // Set up lock
-    FilterLock lock(n);
-    std::vector<std::thread> runner_threads(n);
-    // Start timer
-    start = std::chrono::system_clock::now();
-    // Create threads
-    for (int i = 0; i < n; i++) runner_threads[i] = std::thread(testCS, i, std::ref(lock), std::ref(thread_logs[i]));
-    // Join threads
-    for (int i = 0; i < n; i++) runner_threads[i].join();
-    // End timer
-    auto end = std::chrono::system_clock::now();
-    // Write to output file
-    for (auto &ss : thread_logs) fout << ss.str();
-    // Write program end log
-    fout << "Program ended at " << (end - start).count() << " ns\n";
-    return 0;
-}
\ No newline at end of file
+};
+
+int main(int argc, char *argv[]) {
+    std::vector<LockEntry> locks = policies<PaddedFilterLock>("PaddedFilterLock");
+    locks.push_back(entry<FilterLock>("original", "FilterLock"));
+    return lockMain(argc, argv, locks);
+}
@@ -0,0 +1,466 @@
+/**
+ * @author Gautam Singh
+ * @file harness.hpp
+ * @brief Test harness shared by the locks. In the test, critical section and
+ * waiting for each thread are simulated by exponential delays, with their own
+ * averages, and every request, entry and exit is traced. The harness also
+ * benchmarks the locks with calibrated busy work for a fixed duration, and
+ * chooses between the variants of a lock on the command line.
+ *
+ * @date 2026-10-17
+ */
+
+#pragma once
+
+// Headers
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <iomanip>
+#include "wait.hpp"
+#include "trace.hpp"
+#include "topology.hpp"
+
+// Classes and structs
+
+/**
+ * @brief Result of a microbenchmark of a lock.
+ */
+struct BenchResult {
+    double rate;                /// Acquisitions per second
+    double fairness;            /// Jain's fairness index of the acquisitions of each thread
+    double p50, p99, p999;      /// Percentiles of the handoff latency, in nanoseconds
+    uint64_t violations;        /// Entries while another thread was inside
+};
+
+/**
+ * @brief Lock that can also be held by several readers at once.
+ */
+template<class Lock>
+concept SharedLock = requires(Lock &lock, int id) {
+    lock.lockShared(id);
+    lock.unlockShared(id);
+};
+
+/**
+ * @brief Variant of a lock that can be chosen on the command line.
+ */
+struct LockEntry {
+    const char *name;                                         /// Name of the variant on the command line
+    const char *lock;                                         /// Name of the lock
+    void (*test)(std::vector<TraceRing> &, std::ostream &);   /// Runs testCS with the lock
+    BenchResult (*bench)(int);                                /// Microbenchmarks the lock
+};
+
+// Global variables
+int n, k;
+double lambda_1, lambda_2;
+std::exponential_distribution exp_dist_1, exp_dist_2;
+uint64_t seed;
+/// @brief Parameters of the microbenchmark: duration, and busy work inside
+/// and outside the critical section in nanoseconds
+int bench_ms = 0;
+uint64_t cs_ns = 0, delay_ns = 0;
+/// @brief Iterations of the busy loop per nanosecond
+double iters_per_ns = 1;
+/// @brief Percentage of requests that only read, for locks with readers
+int read_pct = 0;
+
+// Constants
+
+/// @brief Input file
+const char *INFILE = "inp-params.txt";
+/// @brief Output file
+const char *OUTFILE = "out.txt";
+/// @brief Trace file
+const char *TRACEFILE = "out.bin";
+/// @brief Handoff latencies kept per thread in the microbenchmark
+const uint64_t SAMPLES = 1 << 16;
+
+// Runner functions
+
+/**
+ * @brief Acquire a lock, shared if reading and the lock has readers.
+ * @param lock Lock to acquire
+ * @param id Thread ID
+ * @param read Whether the thread only reads in the critical section
+ */
+template<class Lock>
+void acquire(Lock &lock, int id, bool read) {
+    if constexpr (SharedLock<Lock>) {
+        if (read) return lock.lockShared(id);
+    }
+    lock.lock(id);
+}
+
+/**
+ * @brief Release a lock acquired with acquire.
+ * @param lock Lock to release
+ * @param id Thread ID
+ * @param read Whether the thread only read in the critical section
+ */
+template<class Lock>
+void release(Lock &lock, int id, bool read) {
+    if constexpr (SharedLock<Lock>) {
+        if (read) return lock.unlockShared(id);
+    }
+    lock.unlock(id);
+}
+
+/**
+ * @brief Request the critical section k times, tracing every request, entry
+ * and exit.
+ * @param id Thread ID
+ * @param lock Lock guarding the critical section
+ * @param ring Trace ring of the thread
+ */
+template<class Lock>
+void testCS(int id, Lock &lock, TraceRing &ring) {
+    // Every thread draws its delays from its own generator, as the generator
+    // and distributions are not safe to share between threads
+    std::mt19937 gen(seed + id);
+    auto dist_1 = exp_dist_1, dist_2 = exp_dist_2;
+    std::uniform_int_distribution<int> pct(0, 99);
+    for (int i = 0; i < k; i++) {
+        // Read only in some of the requests
+        bool read = SharedLock<Lock> && read_pct && pct(gen) < read_pct;
+        uint16_t shared = read ? SHARED : 0;
+        // Trace CS entry request
+        ring.push(id, ENTRY_REQUEST | shared, i);
+        // Acquire lock
+        acquire(lock, id, read);
+        // Trace CS entry
+        ring.push(id, ENTRY | shared, i);
+        // Sleep in CS
+        std::this_thread::sleep_for(std::chrono::milliseconds((int)dist_1(gen)));
+        // Trace CS exit request
+        ring.push(id, EXIT_REQUEST | shared, i);
+        // Release lock
+        release(lock, id, read);
+        // Trace CS exit
+        ring.push(id, EXIT | shared, i);
+        // Wait before next entry
+        std::this_thread::sleep_for(std::chrono::milliseconds((int)dist_2(gen)));
+    }
+}
+
+/**
+ * @brief Run testCS on n threads with a lock, draining their trace rings into
+ * a trace file until all of them are done.
+ * @param rings Trace ring of each thread
+ * @param trace Stream of the trace file
+ */
+template<class Lock>
+void runTest(std::vector<TraceRing> &rings, std::ostream &trace) {
+    Lock lock(n);
+    std::atomic<int> running = n;
+    std::vector<std::thread> runner_threads(n);
+    auto drain = [&] {
+        for (auto &ring : rings)
+            ring.drain([&](const TraceRecord *r, uint64_t count) { trace.write((const char *)r, count * sizeof(*r)); });
+    };
+    // Create threads
+    for (int i = 0; i < n; i++) {
+        runner_threads[i] = std::thread([&, i] {
+            testCS(i, lock, rings[i]);
+            running.fetch_sub(1, std::memory_order_release);
+        });
+        placeThread(runner_threads[i], i);
+    }
+    // Drain the rings while the threads run
+    while (running.load(std::memory_order_acquire)) {
+        drain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // Join threads
+    for (int i = 0; i < n; i++) runner_threads[i].join();
+    drain();
+}
+
+/**
+ * @brief Spin for some time without touching memory.
+ * @param ns Time to spin for in nanoseconds
+ */
+inline void busyWork(uint64_t ns) {
+    for (uint64_t i = 0, iters = ns * iters_per_ns; i < iters; i++) asm volatile("");
+}
+
+/**
+ * @brief Calibrate busyWork, taking the fastest of a few timed runs of the
+ * busy loop.
+ */
+void calibrate() {
+    const uint64_t ITERS = 1 << 22;
+    double best = 0;
+    for (int r = 0; r < 5; r++) {
+        iters_per_ns = 1;
+        uint64_t begin = steadyNs();
+        busyWork(ITERS);
+        best = std::max(best, (double)ITERS / std::max<uint64_t>(steadyNs() - begin, 1));
+    }
+    iters_per_ns = best;
+}
+
+/**
+ * @brief Microbenchmark a lock: threads acquire it for bench_ms milliseconds,
+ * each time updating a shared counter and spinning for cs_ns inside the
+ * critical section, and for delay_ns before the next request. With locks that
+ * have readers, read_pct percent of the requests only read the counter, in a
+ * shared critical section. Entries of writers while another thread is inside,
+ * and of readers while a writer is inside, are counted as violations. The
+ * handoff latency is the time from the release by a writer to the next entry
+ * of a writer, if the entering thread was already waiting for the release.
+ * @param threads Number of threads
+ * @return Result of the microbenchmark
+ */
+template<class Lock>
+BenchResult bench(int threads) {
+    /**
+     * @brief Counts of a thread, on cache lines of their own.
+     */
+    struct alignas(64) Counts {
+        uint64_t acquisitions = 0;      /// Acquisitions of the lock
+        std::vector<uint64_t> handoffs; /// Latest handoff latencies, in ticks of traceClock
+    };
+
+    Lock lock(threads);
+    std::atomic<bool> go = false, stop = false;
+    std::atomic<int> inside = 0, readers = 0;
+    std::atomic<uint64_t> errors = 0;
+    uint64_t counter = 0, last_release = 0;
+    std::vector<Counts> counts(threads);
+    for (auto &c : counts) c.handoffs.resize(SAMPLES);
+    std::vector<std::thread> runner_threads(threads);
+    for (int i = 0; i < threads; i++) {
+        runner_threads[i] = std::thread([&, i] {
+            Counts &c = counts[i];
+            std::mt19937 gen(seed + i);
+            std::uniform_int_distribution<int> pct(0, 99);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (SharedLock<Lock> && read_pct && pct(gen) < read_pct) {
+                    acquire(lock, i, true);
+                    readers.fetch_add(1, std::memory_order_relaxed);
+                    if (inside.load(std::memory_order_relaxed)) errors.fetch_add(1, std::memory_order_relaxed);
+                    asm volatile("" : : "r"(counter));
+                    busyWork(cs_ns);
+                    readers.fetch_sub(1, std::memory_order_relaxed);
+                    c.handoffs[c.acquisitions++ % SAMPLES] = UINT64_MAX;
+                    release(lock, i, true);
+                    busyWork(delay_ns);
+                    continue;
+                }
+                uint64_t request = traceClock();
+                lock.lock(i);
+                uint64_t entry = traceClock();
+                if (inside.fetch_add(1, std::memory_order_relaxed) || readers.load(std::memory_order_relaxed))
+                    errors.fetch_add(1, std::memory_order_relaxed);
+                if (request < last_release && last_release < entry) c.handoffs[c.acquisitions % SAMPLES] = entry - last_release;
+                else c.handoffs[c.acquisitions % SAMPLES] = UINT64_MAX;
+                counter++;
+                busyWork(cs_ns);
+                inside.fetch_sub(1, std::memory_order_relaxed);
+                c.acquisitions++;
+                last_release = traceClock();
+                lock.unlock(i);
+                busyWork(delay_ns);
+            }
+        });
+        placeThread(runner_threads[i], i);
+    }
+    uint64_t ns0 = steadyNs(), tsc0 = traceClock();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(bench_ms));
+    stop = true;
+    for (int i = 0; i < threads; i++) runner_threads[i].join();
+    uint64_t tsc1 = traceClock(), ns1 = steadyNs();
+    double ns_per_tick = (double)(ns1 - ns0) / std::max<uint64_t>(tsc1 - tsc0, 1);
+    // Throughput and fairness
+    double total = 0, squares = 0;
+    std::vector<uint64_t> handoffs;
+    for (auto &c : counts) {
+        total += c.acquisitions, squares += (double)c.acquisitions * c.acquisitions;
+        for (uint64_t h = 0; h < std::min(c.acquisitions, SAMPLES); h++)
+            if (c.handoffs[h] != UINT64_MAX) handoffs.push_back(c.handoffs[h]);
+    }
+    BenchResult res = {total / ((ns1 - ns0) / 1e9), squares ? total * total / (threads * squares) : 0, 0, 0, 0, errors};
+    // Percentiles of the handoff latency
+    std::sort(handoffs.begin(), handoffs.end());
+    auto pct = [&](double p) {
+        return handoffs.empty() ? 0 : handoffs[std::min<uint64_t>(handoffs.size() - 1, p * handoffs.size())] * ns_per_tick;
+    };
+    res.p50 = pct(0.5), res.p99 = pct(0.99), res.p999 = pct(0.999);
+    return res;
+}
+
+/**
+ * @brief Variant of a lock.
+ * @param name Name of the variant on the command line
+ * @param lock Name of the lock
+ */
+template<class Lock>
+LockEntry entry(const char *name, const char *lock) {
+    return {name, lock, runTest<Lock>, bench<Lock>};
+}
+
+/**
+ * @brief Variants of a lock with every waiting policy, parking first.
+ * @param lock Name of the lock
+ */
+template<template<class> class Lock>
+std::vector<LockEntry> policies(const char *lock) {
+    return {entry<Lock<Park>>(Park::name, lock), entry<Lock<Spin>>(Spin::name, lock),
+            entry<Lock<Pause>>(Pause::name, lock), entry<Lock<Backoff>>(Backoff::name, lock)};
+}
+
+/**
+ * @brief Function to print program help.
+ * @param name Name of executable, usually argv[0]
+ * @param locks Variants of the lock, the first being the default
+ */
+void help(std::string name, const std::vector<LockEntry> &locks) {
+    std::cout << "Usage: " << name << " [options]\n\n"
+              << "Options:\n"
+              << "  -w,--wait    <NAME>  Test the variant NAME of the lock (default " << locks[0].name << ")\n";
+    if (locks.back().name == std::string("original"))
+        std::cout << "  -o,--original        Test the textbook lock, same as -w original\n";
+    std::cout << "  -b,--bench   <MS>    Benchmark every variant (or the one chosen) for MS milliseconds each, and exit\n"
+              << "  -t,--threads <LIST>  Benchmark with each of the comma-separated thread counts (default n)\n"
+              << "  -c,--cs      <NS>    Spin for NS nanoseconds inside the critical section (default " << cs_ns << ")\n"
+              << "  -d,--delay   <NS>    Spin for NS nanoseconds before requesting it again (default " << delay_ns << ")\n"
+              << "  -r,--reads   <PCT>   Only read in PCT percent of the requests, with locks that have readers (default "
+              << read_pct << ")\n"
+              << "  -p,--placement {none|compact|scatter}\n"
+              << "                       Do not pin the threads, or pin them socket by socket, or socket after socket\n"
+              << "                       (default none)\n"
+              << "\nVariants:";
+    for (auto &l : locks) std::cout << ' ' << l.name;
+    std::cout << '\n';
+}
+
+/**
+ * @brief Main function of a lock: read the parameters, and test the chosen
+ * variant of the lock or benchmark all of them.
+ * @param locks Variants of the lock, the first being the default
+ * @return Exit code of the program
+ */
+int lockMain(int argc, char *argv[], const std::vector<LockEntry> &locks) {
+    // Parse options
+    std::string variant = locks[0].name, thread_list;
+    bool chose = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" || arg == "--original") {
+            variant = "original", chose = true;
+        } else if ((arg == "-w" || arg == "--wait") && i + 1 < argc) {
+            variant = argv[++i], chose = true;
+        } else if ((arg == "-b" || arg == "--bench") && i + 1 < argc) {
+            bench_ms = std::stoi(argv[++i]);
+        } else if ((arg == "-t" || arg == "--threads") && i + 1 < argc) {
+            thread_list = argv[++i];
+        } else if ((arg == "-c" || arg == "--cs") && i + 1 < argc) {
+            cs_ns = std::stoull(argv[++i]);
+        } else if ((arg == "-d" || arg == "--delay") && i + 1 < argc) {
+            delay_ns = std::stoull(argv[++i]);
+        } else if ((arg == "-r" || arg == "--reads") && i + 1 < argc) {
+            read_pct = std::clamp(std::stoi(argv[++i]), 0, 100);
+        } else if ((arg == "-p" || arg == "--placement") && i + 1 < argc) {
+            std::string p = argv[++i];
+            if (p == "none") setPlacement(NONE);
+            else if (p == "compact") setPlacement(COMPACT);
+            else if (p == "scatter") setPlacement(SCATTER);
+            else {
+                std::cout << "[ERROR] Unknown placement " << p << ".\n";
+                return 1;
+            }
+        } else {
+            help(argv[0], locks);
+            return 1;
+        }
+    }
+    const LockEntry *chosen = NULL;
+    for (auto &l : locks) if (variant == l.name) chosen = &l;
+    if (!chosen) {
+        std::cout << "[ERROR] Unknown variant " << variant << ".\n";
+        return 1;
+    }
+    // Set up file IO streams
+    std::fstream fin(INFILE, std::fstream::in), fout(OUTFILE, std::fstream::out);
+    // Ensure the filestreams are created
+    if (!fin) {
+        std::cout << "[ERROR] Input file " << INFILE << " not found.\n";
+        return 1;
+    }
+    if (!fout) {
+        std::cout << "[ERROR] Output file " << OUTFILE << " not created.\n";
+        return 1;
+    }
+    // Read parameters
+    fin >> n >> k >> lambda_1 >> lambda_2;
+    // Set up distributions and random number generator seed
+    exp_dist_1 = std::exponential_distribution(lambda_1);
+    exp_dist_2 = std::exponential_distribution(lambda_2);
+    seed = std::chrono::system_clock::now().time_since_epoch().count();
+    if (bench_ms) {
+        std::vector<int> thread_counts;
+        std::istringstream is(thread_list);
+        for (std::string t; std::getline(is, t, ',');) thread_counts.push_back(std::max(std::stoi(t), 1));
+        if (thread_counts.empty()) thread_counts.push_back(n);
+        calibrate();
+        std::cout << bench_ms << " ms per run, " << cs_ns << " ns inside and " << delay_ns
+                  << " ns outside the critical section, " << read_pct << "% reads, "
+                  << cpus().size() << " CPUs on " << numSockets() << " sockets\n\n"
+                  << std::left << std::setw(9) << "threads" << std::setw(30) << "lock" << std::right
+                  << std::setw(16) << "acquisitions/s" << std::setw(10) << "fairness" << std::setw(12) << "p50 (ns)"
+                  << std::setw(12) << "p99 (ns)" << std::setw(12) << "p99.9 (ns)" << std::setw(12) << "violations\n";
+        for (int threads : thread_counts)
+            for (auto &l : locks) {
+                if (chose && &l != chosen) continue;
+                BenchResult r = l.bench(threads);
+                std::cout << std::left << std::setw(9) << threads
+                          << std::setw(30) << std::string(l.lock) + " (" + l.name + ")" << std::right << std::fixed
+                          << std::setprecision(0) << std::setw(16) << r.rate << std::setprecision(3) << std::setw(10)
+                          << r.fairness << std::setprecision(0) << std::setw(12) << r.p50 << std::setw(12) << r.p99
+                          << std::setw(12) << r.p999 << std::setw(11) << r.violations << std::endl;
+            }
+        return 0;
+    }
+    // Set up tracing
+    std::fstream ftrace(TRACEFILE, std::fstream::out | std::fstream::binary);
+    if (!ftrace) {
+        std::cout << "[ERROR] Trace file " << TRACEFILE << " not created.\n";
+        return 1;
+    }
+    TraceHeader hdr = {};
+    std::memcpy(hdr.magic, "LOCKTRC1", 8);
+    hdr.n = n, hdr.k = k;
+    std::snprintf(hdr.lock, sizeof(hdr.lock), "%s (%s)", chosen->lock, chosen->name);
+    ftrace.write((const char *)&hdr, sizeof(hdr));
+    std::vector<TraceRing> rings(n);
+    // Start timer
+    hdr.ns0 = steadyNs(), hdr.tsc0 = traceClock();
+    // Run threads with the chosen lock
+    chosen->test(rings, ftrace);
+    // End timer
+    hdr.tsc1 = traceClock(), hdr.ns1 = steadyNs();
+    // Complete the header with the calibration of the clock
+    ftrace.seekp(0);
+    ftrace.write((const char *)&hdr, sizeof(hdr));
+    ftrace.close();
+    // Decode the trace into the output file
+    std::vector<TraceRecord> records;
+    if (!readTrace(TRACEFILE, hdr, records)) {
+        std::cout << "[ERROR] Trace file " << TRACEFILE << " not readable.\n";
+        return 1;
+    }
+    writeLog(hdr, records, fout);
+    return 0;
+}
@@ -0,0 +1,98 @@
+/**
+ * @author Gautam Singh
+ * @file MCS-CS21BTECH11018.cpp
+ * @brief C++ source for implementing the MCS Lock and testing it on a
+ * multithreaded application. In this application, critical section and waiting
+ * for each thread are simulated by exponential delays, with their own averages. 
+ *
+ * @date 2024-09-16
+ */
+
+// Headers
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <utility>
+#include <string>
+#include <random>
+#include <thread>
+#include <atomic>
+#include "harness.hpp"
+
+// Classes and structs
+
+/**
+ * @class MCSLock
+ * @brief An implementation of the MCS queue lock. Threads append their own
+ * queue node to a shared tail, and spin on a flag in their node until their
+ * predecessor hands the lock over. Each node sits on its own cache line, so
+ * every waiter spins on a line no other waiter touches. Waiting threads wait
+ * through the policy Wait of wait.hpp, on the wait word of their own node,
+ * as does a releasing thread whose successor has not linked in yet.
+ */
+template<class Wait>
+class MCSLock {
+private:
+    /**
+     * @brief Queue node of a thread.
+     */
+    struct alignas(64) QNode {
+        std::atomic<QNode *> next = nullptr;    /// Successor in the queue
+        std::atomic<bool> locked = false;       /// Whether the thread must wait
+        WaitWord handoff;                       /// Signalled when the lock is handed over
+        WaitWord linked;                        /// Signalled when the successor links in
+    };
+
+    size_t n;                                   /// Number of threads
+    std::vector<QNode> nodes;                   /// Queue node of each thread
+    alignas(64) std::atomic<QNode *> tail = nullptr;    /// Last node in the queue
+public:
+    /**
+     * @brief Constructor method for MCSLock
+     * @param N Number of threads
+     */
+    MCSLock(size_t _n) : n(_n), nodes(n) {}
+
+    /**
+     * @brief Method to acquire MCSLock
+     * @param id Thread ID
+     */
+    void lock(int id) {
+        QNode *node = &nodes[id];
+        node->next.store(nullptr, std::memory_order_relaxed);
+        node->locked.store(true, std::memory_order_relaxed);
+        // Join the queue, and wait for the predecessor if there is one
+        QNode *pred = tail.exchange(node, std::memory_order_acq_rel);
+        if (pred) {
+            pred->next.store(node, std::memory_order_release);
+            Wait::wake(pred->linked);
+            Wait::wait(node->handoff, [&] { return !node->locked.load(std::memory_order_acquire); });
+        }
+    }
+
+    /**
+     * @brief Method to release MCSLock
+     * @param id Thread ID
+     */
+    void unlock(int id) {
+        QNode *node = &nodes[id];
+        QNode *succ = node->next.load(std::memory_order_acquire);
+        if (!succ) {
+            // No successor yet: leave the queue empty, or wait for it to link in
+            QNode *expected = node;
+            if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release,
+                                             std::memory_order_relaxed)) return;
+            // The successor may have been preempted between joining and linking in
+            Wait::wait(node->linked, [&] { return (succ = node->next.load(std::memory_order_acquire)) != nullptr; });
+        }
+        succ->locked.store(false, std::memory_order_release);
+        Wait::wake(succ->handoff);
+    }
+};
+
+int main(int argc, char *argv[]) {
+    std::vector<LockEntry> locks = policies<MCSLock>("MCSLock");
+    return lockMain(argc, argv, locks);
+}
@@ -15,11 +15,11 @@ import matplotlib.pyplot as plt
 # Constants
 IMG_PATH = "../report/images"
 CC = "g++"
-SRC_LIST = ["bakery.cpp", "filter.cpp"]
+SRC_LIST = ["bakery.cpp", "filter.cpp", "mcs.cpp", "clh.cpp", "rwlock.cpp", "cohort.cpp"]
 EXE = ".\\a.exe" # "./a.out" for Linux
 INPUT_FILE = "inp-params.txt"
 OUTPUT_FILE = "out.txt"
-NUM_THREADS = [2, 4, 8, 16, 32, 64]
+NUM_THREADS = [2, 4, 8, 16, 32, 64, 128]
 NUM_REQS = [5, 10, 15, 20, 25]
 NUM_RUNS = 20
 LAMBDA_1 = 1
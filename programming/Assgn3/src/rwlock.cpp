@@ -0,0 +1,109 @@
+/**
+ * @author Gautam Singh
+ * @file RW-CS21BTECH11018.cpp
+ * @brief C++ source for implementing a scalable reader-writer lock and testing
+ * it on a multithreaded application. In this application, critical section and
+ * waiting for each thread are simulated by exponential delays, with their own
+ * averages.
+ *
+ * @date 2026-10-17
+ */
+
+// Headers
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <utility>
+#include <string>
+#include <random>
+#include <thread>
+#include <atomic>
+#include "harness.hpp"
+
+// Classes and structs
+
+/**
+ * @class RWLock
+ * @brief A reader-writer lock with a slot per reader. A reader announces
+ * itself in its own slot, on a cache line of its own, and enters unless a
+ * writer is active, so readers never write a shared cache line. Writers queue
+ * on a ticket lock, raise the writer flag, which turns new readers away, and
+ * wait for the readers inside to leave. Waiting threads wait through the
+ * policy Wait of wait.hpp.
+ */
+template<class Wait>
+class RWLock {
+private:
+    /**
+     * @brief Slot of a reader, on a cache line of its own.
+     */
+    struct alignas(64) Slot {
+        std::atomic<bool> reading = false;  /// Whether the reader is inside, or about to enter
+    };
+
+    size_t n;                                       /// Number of threads
+    std::vector<Slot> readers;                      /// Slot of each reader
+    alignas(64) std::atomic<bool> writer = false;   /// Whether a writer is inside, or draining readers
+    alignas(64) std::atomic<uint32_t> next = 0;     /// Next ticket of the writers
+    alignas(64) std::atomic<uint32_t> serving = 0;  /// Ticket of the writer allowed in
+    alignas(64) WaitWord changed;                   /// Signalled after a writer leaves, or a reader backs off
+public:
+    /**
+     * @brief Constructor method for RWLock
+     * @param N Number of threads
+     */
+    RWLock(size_t _n) : n(_n), readers(n) {}
+
+    /**
+     * @brief Method to acquire RWLock for writing. Writers have no slot, so
+     * the thread ID is unused.
+     */
+    void lock(int) {
+        uint32_t ticket = next.fetch_add(1, std::memory_order_relaxed);
+        Wait::wait(changed, [&] { return serving.load(std::memory_order_acquire) == ticket; });
+        // The flag and the slots are ordered as in Dekker's algorithm: either
+        // a reader sees the flag, or the writer sees its slot
+        writer.store(true);
+        for (size_t i = 0; i < n; i++) Wait::wait(changed, [&] { return !readers[i].reading.load(); });
+    }
+
+    /**
+     * @brief Method to release RWLock after writing. The thread ID is unused.
+     */
+    void unlock(int) {
+        writer.store(false, std::memory_order_release);
+        serving.store(serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        Wait::wake(changed);
+    }
+
+    /**
+     * @brief Method to acquire RWLock for reading
+     * @param id Thread ID
+     */
+    void lockShared(int id) {
+        while (true) {
+            readers[id].reading.store(true);
+            if (!writer.load()) return;
+            // Back off until the writer leaves
+            unlockShared(id);
+            Wait::wait(changed, [&] { return !writer.load(std::memory_order_acquire); });
+        }
+    }
+
+    /**
+     * @brief Method to release RWLock after reading
+     * @param id Thread ID
+     */
+    void unlockShared(int id) {
+        readers[id].reading.store(false);
+        // Only a writer waits for readers, and it raises its flag first
+        if (writer.load()) Wait::wake(changed);
+    }
+};
+
+int main(int argc, char *argv[]) {
+    std::vector<LockEntry> locks = policies<RWLock>("RWLock");
+    return lockMain(argc, argv, locks);
+}
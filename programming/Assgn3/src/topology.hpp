@@ -0,0 +1,118 @@
+/**
+ * @author Gautam Singh
+ * @file topology.hpp
+ * @brief Sockets of the CPUs the program may run on, and placement of the
+ * threads of the test on them. Thread i runs on the i-th CPU of the placement
+ * order, wrapping around when there are more threads than CPUs, and belongs to
+ * the socket of that CPU even when it is not pinned there.
+ *
+ * Placements: none (not pinned), compact (socket by socket), scatter (socket
+ * after socket).
+ *
+ * @date 2026-10-17
+ */
+
+#pragma once
+
+// Headers
+#include <fstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+
+// Classes and structs
+
+/**
+ * @brief CPU the program may run on.
+ */
+struct Cpu {
+    int id;         /// ID of the CPU
+    int socket;     /// Socket of the CPU, counted from 0
+};
+
+/**
+ * @brief Placements of the threads on the CPUs.
+ */
+enum Placement { NONE, COMPACT, SCATTER };
+
+// Global variables
+
+/// @brief Placement of the threads
+Placement placement = NONE;
+/// @brief CPUs in the order threads are placed on them
+std::vector<Cpu> placement_order;
+
+/**
+ * @brief CPUs the program may run on, ordered socket by socket. Sockets are
+ * renumbered from 0, and CPUs without topology information are on socket 0.
+ */
+const std::vector<Cpu> &cpus() {
+    static std::vector<Cpu> list = [] {
+        std::vector<Cpu> res;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set)) CPU_SET(0, &set);
+        std::vector<int> packages;
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (!CPU_ISSET(c, &set)) continue;
+            std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(c) + "/topology/physical_package_id");
+            int package = 0;
+            in >> package;
+            if (std::find(packages.begin(), packages.end(), package) == packages.end()) packages.push_back(package);
+            res.push_back({c, package});
+        }
+        std::sort(packages.begin(), packages.end());
+        for (Cpu &cpu : res) cpu.socket = std::find(packages.begin(), packages.end(), cpu.socket) - packages.begin();
+        std::stable_sort(res.begin(), res.end(), [](const Cpu &a, const Cpu &b) { return a.socket < b.socket; });
+        return res;
+    }();
+    return list;
+}
+
+/**
+ * @brief Number of sockets the program may run on.
+ */
+int numSockets() {
+    return cpus().back().socket + 1;
+}
+
+/**
+ * @brief Set the placement of the threads.
+ * @param p Placement
+ */
+void setPlacement(Placement p) {
+    placement = p;
+    placement_order = cpus();
+    if (p != SCATTER) return;
+    // Take the CPUs of every socket in turn
+    std::vector<std::vector<Cpu>> sockets(numSockets());
+    for (const Cpu &cpu : cpus()) sockets[cpu.socket].push_back(cpu);
+    placement_order.clear();
+    for (size_t i = 0; placement_order.size() < cpus().size(); i++)
+        for (auto &s : sockets) if (i < s.size()) placement_order.push_back(s[i]);
+}
+
+/**
+ * @brief Socket of a thread.
+ * @param id Thread ID
+ */
+int threadSocket(int id) {
+    if (placement_order.empty()) setPlacement(placement);
+    return placement_order[id % placement_order.size()].socket;
+}
+
+/**
+ * @brief Pin a thread to its CPU, unless the threads are not placed.
+ * @param t Thread
+ * @param id Thread ID
+ */
+void placeThread(std::thread &t, int id) {
+    if (placement == NONE) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(placement_order[id % placement_order.size()].id, &set);
+    pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+}
@@ -0,0 +1,187 @@
+/**
+ * @author Gautam Singh
+ * @file trace.hpp
+ * @brief Binary event tracing of the lock test. Every thread appends fixed-size
+ * records, timestamped with the time stamp counter, to a ring of its own, which
+ * the main thread drains into a trace file while the test runs. The trace is
+ * decoded after the run into the text log, and into the distribution of the
+ * time threads wait to enter the critical section.
+ *
+ * @date 2026-10-17
+ */
+
+#pragma once
+
+// Headers
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Classes and structs
+
+/**
+ * @brief Events of a thread in the test. Events of readers of a lock also
+ * carry the flag SHARED.
+ */
+enum TraceEvent : uint16_t { ENTRY_REQUEST = 0, ENTRY = 1, EXIT_REQUEST = 2, EXIT = 3, SHARED = 4 };
+
+/**
+ * @brief Record of an event.
+ */
+struct TraceRecord {
+    uint64_t tsc;       /// Time stamp counter at the event
+    uint16_t thread;    /// Thread ID
+    uint16_t event;     /// Event, a TraceEvent
+    uint32_t iter;      /// Index of the request
+};
+
+static_assert(sizeof(TraceRecord) == 16);
+
+/**
+ * @brief Header of a trace file. The time stamp counter is calibrated against
+ * steady_clock at the start and the end of the run.
+ */
+struct TraceHeader {
+    char magic[8];      /// Magic bytes, "LOCKTRC1"
+    char lock[48];      /// Name of the lock and its variant
+    uint32_t n;         /// Number of threads
+    uint32_t k;         /// Number of requests per thread
+    uint64_t tsc0;      /// Time stamp counter at the start of the run
+    uint64_t ns0;       /// steady_clock at the start of the run, in nanoseconds
+    uint64_t tsc1;      /// Time stamp counter at the end of the run
+    uint64_t ns1;       /// steady_clock at the end of the run, in nanoseconds
+
+    /**
+     * @brief Nanoseconds since the start of the run at a time stamp counter.
+     */
+    uint64_t ns(uint64_t tsc) const {
+        return tsc1 == tsc0 ? 0 : (uint64_t)((double)(tsc - tsc0) * (ns1 - ns0) / (tsc1 - tsc0));
+    }
+};
+
+static_assert(sizeof(TraceHeader) == 96);
+
+/**
+ * @brief Read the clock of trace records: the time stamp counter on x86, and
+ * steady_clock in nanoseconds elsewhere.
+ */
+inline uint64_t traceClock() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+/**
+ * @brief Nanoseconds of steady_clock, for calibrating the time stamp counter.
+ */
+inline uint64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @class TraceRing
+ * @brief Single-producer single-consumer ring of trace records. The producer
+ * only waits when the ring is full, which happens only if the consumer falls
+ * a whole ring behind.
+ */
+class TraceRing {
+private:
+    static constexpr uint64_t CAPACITY = 1024;          /// Number of records, a power of two
+
+    alignas(64) std::atomic<uint64_t> head = 0;         /// Records pushed, written by the producer
+    uint64_t free = CAPACITY;                           /// Slots known to be free, producer only
+    alignas(64) std::atomic<uint64_t> tail = 0;         /// Records drained, written by the consumer
+    alignas(64) TraceRecord records[CAPACITY];          /// Records in the ring
+public:
+    /**
+     * @brief Append a record, called by the producer.
+     */
+    void push(uint16_t thread, uint16_t event, uint32_t iter) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        // Only look at the tail of the consumer when out of known free slots
+        while (!free) {
+            free = CAPACITY - (h - tail.load(std::memory_order_acquire));
+            if (!free) std::this_thread::yield();
+        }
+        records[h % CAPACITY] = {traceClock(), thread, event, iter};
+        free--;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Pass every pushed record to a function and free its slot, called
+     * by the consumer.
+     * @param out Function taking a pointer to records and their number
+     */
+    template<class Out>
+    void drain(Out out) {
+        uint64_t t = tail.load(std::memory_order_relaxed), h = head.load(std::memory_order_acquire);
+        // The records wrap around at most once
+        uint64_t first = std::min(h - t, CAPACITY - t % CAPACITY);
+        if (first) out(&records[t % CAPACITY], first);
+        if (h - t > first) out(&records[0], h - t - first);
+        tail.store(h, std::memory_order_release);
+    }
+};
+
+/**
+ * @brief Read a trace file.
+ * @param file Path of the trace file
+ * @param hdr Populated with the header of the trace
+ * @param records Populated with the records of the trace
+ * @return true on success, false on failure
+ */
+inline bool readTrace(const char *file, TraceHeader &hdr, std::vector<TraceRecord> &records) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in.read((char *)&hdr, sizeof(hdr)) || std::memcmp(hdr.magic, "LOCKTRC1", 8)) return false;
+    TraceRecord r;
+    while (in.read((char *)&r, sizeof(r))) records.push_back(r);
+    return in.eof();
+}
+
+/**
+ * @brief Write the text log of a trace, thread by thread.
+ * @param hdr Header of the trace
+ * @param records Records of the trace
+ * @param out Stream to write the log to
+ */
+inline void writeLog(const TraceHeader &hdr, std::vector<TraceRecord> records, std::ostream &out) {
+    static const char *NAMES[] = {"CS Entry Request ", "CS Entry ", "CS Exit Request ", "CS Exit "};
+    // Records of a thread are drained in order, so a stable sort keeps them so
+    std::stable_sort(records.begin(), records.end(),
+                     [](const TraceRecord &a, const TraceRecord &b) { return a.thread < b.thread; });
+    for (const TraceRecord &r : records)
+        out << NAMES[r.event & 3] << r.iter + 1 << " at " << hdr.ns(r.tsc) << " ns by thread " << r.thread + 1
+            << (r.event & SHARED ? " (shared)\n" : "\n");
+    out << "Program ended at " << hdr.ns1 - hdr.ns0 << " ns\n";
+}
+
+/**
+ * @brief Times threads waited to enter the critical section.
+ * @param hdr Header of the trace
+ * @param records Records of the trace
+ * @return Time between each entry request and its entry, in nanoseconds
+ */
+inline std::vector<uint64_t> waitTimes(const TraceHeader &hdr, const std::vector<TraceRecord> &records) {
+    std::vector<uint64_t> requested((uint64_t)hdr.n * hdr.k), waits;
+    for (const TraceRecord &r : records) {
+        if (r.thread >= hdr.n || r.iter >= hdr.k) continue;
+        uint64_t &req = requested[(uint64_t)r.thread * hdr.k + r.iter];
+        if ((r.event & 3) == ENTRY_REQUEST) req = r.tsc;
+        else if ((r.event & 3) == ENTRY) waits.push_back(hdr.ns(r.tsc) - hdr.ns(req));
+    }
+    return waits;
+}
@@ -0,0 +1,126 @@
+/**
+ * @author Gautam Singh
+ * @file wait.hpp
+ * @brief Waiting policies of the production locks. A lock waits through its
+ * policy until a condition holds, and tells the policy whenever the condition
+ * may have started to hold, so that a policy putting threads to sleep knows
+ * when to wake them up.
+ *
+ * Policies: Spin, Pause, Backoff, Park.
+ *
+ * @date 2026-10-17
+ */
+
+#pragma once
+
+// Headers
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <thread>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Classes and structs
+
+/**
+ * @brief Word a lock signals whenever one of its waiting conditions may have
+ * started to hold. Only Park uses it; the other policies ignore it.
+ */
+struct WaitWord {
+    std::atomic<uint32_t> seq = 0;      /// Number of signals, the futex word
+    std::atomic<uint32_t> parked = 0;   /// Threads parked, or about to park, on the word
+};
+
+/**
+ * @brief Spin on the condition without pausing.
+ */
+struct Spin {
+    static constexpr const char *name = "spin";
+
+    template<class Done>
+    static void wait(WaitWord &, Done done) {
+        while (!done());
+    }
+
+    static void wake(WaitWord &) {}
+};
+
+/**
+ * @brief Spin on the condition with a pause between checks, which frees the
+ * pipeline for the sibling hyperthread and avoids a memory order violation
+ * when the condition changes.
+ */
+struct Pause {
+    static constexpr const char *name = "pause";
+
+    template<class Done>
+    static void wait(WaitWord &, Done done) {
+        while (!done()) __builtin_ia32_pause();
+    }
+
+    static void wake(WaitWord &) {}
+};
+
+/**
+ * @brief Check the condition after exponentially growing delays. Once the
+ * delay is at its cap the thread also yields its core, which is where the
+ * lock holder is when there are more threads than cores.
+ */
+struct Backoff {
+    static constexpr const char *name = "backoff";
+    static constexpr uint32_t MAX_DELAY = 1024;     /// Longest delay, in pauses
+
+    template<class Done>
+    static void wait(WaitWord &, Done done) {
+        for (uint32_t delay = 1; !done(); delay = std::min(2 * delay, MAX_DELAY)) {
+            for (uint32_t i = 0; i < delay; i++) __builtin_ia32_pause();
+            if (delay == MAX_DELAY) std::this_thread::yield();
+        }
+    }
+
+    static void wake(WaitWord &) {}
+};
+
+/**
+ * @brief Spin on the condition briefly, and then park in the kernel on a futex
+ * until the lock signals the wait word.
+ */
+struct Park {
+    static constexpr const char *name = "park";
+    static constexpr int SPINS = 256;   /// Checks of the condition before parking
+
+    static long futex(WaitWord &w, int op, uint32_t val) {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t *>(&w.seq), op, val, NULL, NULL, 0);
+    }
+
+    template<class Done>
+    static void wait(WaitWord &w, Done done) {
+        for (int i = 0; i < SPINS; i++) {
+            if (done()) return;
+            __builtin_ia32_pause();
+        }
+        while (true) {
+            // Announce the thread before reading the word. Either the waker
+            // sees the announcement and wakes it, or its signal comes after
+            // the read and the futex does not put the thread to sleep.
+            w.parked.fetch_add(1);
+            uint32_t s = w.seq.load();
+            bool ready = done();
+            if (!ready) futex(w, FUTEX_WAIT_PRIVATE, s);
+            w.parked.fetch_sub(1, std::memory_order_relaxed);
+            if (ready || done()) return;
+        }
+    }
+
+    /**
+     * @brief Signal the wait word, after changing the state a waiting
+     * condition reads, and wake the threads parked on it.
+     */
+    static void wake(WaitWord &w) {
+        w.seq.fetch_add(1);
+        if (w.parked.load()) futex(w, FUTEX_WAKE_PRIVATE, INT_MAX);
+    }
+};
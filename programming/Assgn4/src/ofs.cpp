@@ -20,39 +20,11 @@
 #include <random>
 #include <thread>
 #include <atomic>
+#include <sstream>
+#include "registers.hpp"
 
 // Classes and structs
 
-/**
- * @brief An implementation of a timestamped value. It contains a value and a
- * timestamp.
- */
-template<class T>
-struct StampedValue {
-    T value;        // Value stored
-    uint16_t stamp; // Timestamp
-    uint16_t id;    // Thread id
-
-    /**
-     * @brief Constructor method for StampedValue.
-     * @param val Value.
-     * @param ts Timestamp.
-     * @param tid Thread id.
-     */
-    StampedValue(T val, uint16_t ts = 0, uint16_t tid = 0) : value(val), stamp(ts), id(tid) {}
-
-    bool operator == (const StampedValue<T> stval) const {
-        return value == stval.value and stamp == stval.stamp and id == stval.id;
-    }
-
-    bool operator != (const StampedValue<T> stval) const {
-        return !(*this == stval);
-    }
-};
-
-template<class T> using A = std::atomic<StampedValue<T>>;
-template<class T> using P = std::unique_ptr<A<T>>;
-
 /**
  * @brief A struct containing relevant information carried by a log.
  */
@@ -86,29 +58,30 @@ struct Log {
     }
 };
 
-thread_local uint16_t sn = 0;
+thread_local uint64_t sn = 0;
 
 /**
  * @class Implementation of obstruction-free MRMW snapshot interface.
  * @param m Size of the shared array.
+ * @param w Number of writers, with ids 0 to w - 1.
+ * @param R Registers of the shared array, from registers.hpp.
  */
-template<typename T>
+template<typename T, class R = SlotRegisters<T>>
 class OFSnapshot {
 private:
-    std::vector<P<T>> shArr;
+    R shArr;
 public:
-    OFSnapshot(int m) : shArr(m) { for (auto &u : shArr) u = std::make_unique<A<T>>(StampedValue<T>(0, 0, 0)); }
+    OFSnapshot(int m, int w) : shArr(m, w) {}
     
     /**
      * @brief Set the value at memory location `l` to `v`.
      * @param l Location whose value is to be updated.
      * @param v New value to be inserted at location `l`.
+     * @param id Id of the calling thread, unique among the writers.
      */
-    void update(int l, T v) {
-        // Get thread id
-        uint16_t tid = std::hash<std::thread::id>{}(std::this_thread::get_id());
-        // Replace with pointer to own thread id and sequence number.
-        shArr[l] = std::make_unique<A<T>>(StampedValue<T>(v, ++sn, tid));
+    void update(int l, T v, uint16_t id) {
+        // Replace with own thread id and sequence number.
+        shArr.store(l, StampedValue<T>(v, ++sn, id));
     }
 
     /**
@@ -118,7 +91,8 @@ public:
      */
     std::vector<StampedValue<T>> collect() {
         std::vector<StampedValue<T>> copy;
-        for (auto &u : shArr) copy.push_back(*u);
+        copy.reserve(shArr.size());
+        for (size_t l = 0; l < shArr.size(); l++) copy.push_back(shArr.load(l));
         return copy;
     }
 
@@ -165,8 +139,8 @@ const char* OUTFILE = "out.txt";
 
 // Runner functions
 
-template<class T>
-void writerThreadRunner(uint16_t id, OFSnapshot<T> &snapObj, std::vector<Log> &log) {
+template<class T, class R>
+void writerThreadRunner(uint16_t id, OFSnapshot<T, R> &snapObj, std::vector<Log> &log) {
     std::stringstream ss;
     while (!term) {
         // Get l, v
@@ -174,7 +148,7 @@ void writerThreadRunner(uint16_t id, OFSnapshot<T> &snapObj, std::vector<Log> &l
         T v = valDist(rng);
         // Perform write
         auto writeStart = std::chrono::system_clock::now();
-        snapObj.update(l, v);
+        snapObj.update(l, v, id);
         auto writeEnd = std::chrono::system_clock::now();
         // Log write with timestamp
         ss.str(std::string());
@@ -188,8 +162,8 @@ void writerThreadRunner(uint16_t id, OFSnapshot<T> &snapObj, std::vector<Log> &l
     }
 }
 
-template<class T>
-void snapshotThreadRunner(uint16_t id, OFSnapshot<T> &snapObj, std::vector<Log> &log) {
+template<class T, class R>
+void snapshotThreadRunner(uint16_t id, OFSnapshot<T, R> &snapObj, std::vector<Log> &log) {
     std::stringstream ss;
     for (uint32_t i = 0; i < k; i++) {
         // Do the snapshot
@@ -209,24 +183,13 @@ void snapshotThreadRunner(uint16_t id, OFSnapshot<T> &snapObj, std::vector<Log>
     }
 }
 
-int main(int argc, char *argv []) {
-    // Input parsing
-    std::fstream fin(INFILE, std::fstream::in);
-    if (!fin) {
-        std::cerr << "[ERROR] Input file " << INFILE << " not found.\n";
-        return 1;
-    }
-    std::fstream fout(OUTFILE, std::fstream::out);
-    if (!fout) {
-        std::cerr << "[ERROR] Could not create output file " << OUTFILE << ".\n";
-        return 1;
-    }
-    fin >> nw >> ns >> M >> lambda_w >> lambda_s >> k;
-    // Set up the generators
-    locDist = std::uniform_int_distribution<uint32_t>(0, M - 1);
-    valDist = std::uniform_int_distribution<uint32_t>();
-    writerSleepDist = std::exponential_distribution<double>(lambda_w);
-    snapshotSleepDist = std::exponential_distribution<double>(lambda_s);
+/**
+ * @brief Run nw writer and ns snapshot threads on a snapshot object, and write
+ * their logs in order of time.
+ * @param fout Output file stream.
+ */
+template<class R>
+void runTest(std::fstream &fout) {
     // Set up the termination flag
     term = false;
     // Create threads
@@ -234,13 +197,13 @@ int main(int argc, char *argv []) {
     // Create loggers
     std::vector<std::vector<Log>> writerLogs(nw), snapshotLogs(ns);
     // Create OFS object
-    OFSnapshot<uint32_t> snapObj(M);
+    OFSnapshot<uint32_t, R> snapObj(M, nw);
     // Start the threads: writer followed by snapshot threads
     for (uint16_t i = 0; i < nw; i++) {
-        writerThreads[i] = std::thread{writerThreadRunner<uint32_t>, i, std::ref(snapObj), std::ref(writerLogs[i])};
+        writerThreads[i] = std::thread{writerThreadRunner<uint32_t, R>, i, std::ref(snapObj), std::ref(writerLogs[i])};
     }
     for (uint16_t i = 0; i < ns; i++) {
-        snapshotThreads[i] = std::thread{snapshotThreadRunner<uint32_t>, i, std::ref(snapObj), std::ref(snapshotLogs[i])};
+        snapshotThreads[i] = std::thread{snapshotThreadRunner<uint32_t, R>, i, std::ref(snapObj), std::ref(snapshotLogs[i])};
     }
     // Join snapshot threads
     for (auto &th : snapshotThreads) th.join();
@@ -254,5 +217,100 @@ int main(int argc, char *argv []) {
     for (auto &lg : snapshotLogs) out.insert(out.end(), lg.begin(), lg.end());
     sort(out.begin(), out.end());
     for (auto &lg : out) fout << lg;
+}
+
+/**
+ * @brief Measure the throughput of a snapshot object: nw writer threads update
+ * random locations and ns snapshot threads take snapshots, back to back, for
+ * `ms` milliseconds.
+ * @param ms Duration of the measurement in milliseconds.
+ * @param updates Populated with the updates per second.
+ * @param snapshots Populated with the snapshots per second.
+ */
+template<class R>
+void bench(int ms, double &updates, double &snapshots) {
+    /**
+     * @brief Count of operations of a thread, on a cache line of its own.
+     */
+    struct alignas(64) Count {
+        uint64_t ops = 0;
+    };
+
+    OFSnapshot<uint32_t, R> snapObj(M, nw);
+    std::atomic<bool> stop = false;
+    std::vector<Count> counts(nw + ns);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < nw + ns; i++) {
+        threads.emplace_back([&, i] {
+            // Every thread draws its locations and values from its own generator
+            std::mt19937 gen(i);
+            auto loc = locDist;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (i < nw) snapObj.update(loc(gen), gen(), i);
+                else snapObj.snapshot();
+                counts[i].ops++;
+            }
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    stop = true;
+    for (auto &th : threads) th.join();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    updates = snapshots = 0;
+    for (uint32_t i = 0; i < nw + ns; i++) (i < nw ? updates : snapshots) += counts[i].ops / secs;
+}
+
+int main(int argc, char *argv []) {
+    // Parse options
+    std::string regs = SlotRegisters<uint32_t>::name;
+    int benchMs = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-r" || arg == "--registers") && i + 1 < argc) {
+            regs = argv[++i];
+        } else if ((arg == "-b" || arg == "--bench") && i + 1 < argc) {
+            benchMs = std::stoi(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [options]\n\n"
+                      << "Options:\n"
+                      << "  -r,--registers {slot|heap}  Use fixed atomic registers, or registers reallocated on every write (default slot)\n"
+                      << "  -b,--bench <MS>             Compare the throughput with both kinds of registers for MS milliseconds each, and exit\n";
+            return 1;
+        }
+    }
+    if (regs != SlotRegisters<uint32_t>::name && regs != HeapRegisters<uint32_t>::name) {
+        std::cerr << "[ERROR] Unknown registers " << regs << ".\n";
+        return 1;
+    }
+    // Input parsing
+    std::fstream fin(INFILE, std::fstream::in);
+    if (!fin) {
+        std::cerr << "[ERROR] Input file " << INFILE << " not found.\n";
+        return 1;
+    }
+    std::fstream fout(OUTFILE, std::fstream::out);
+    if (!fout) {
+        std::cerr << "[ERROR] Could not create output file " << OUTFILE << ".\n";
+        return 1;
+    }
+    fin >> nw >> ns >> M >> lambda_w >> lambda_s >> k;
+    // Set up the generators
+    locDist = std::uniform_int_distribution<uint32_t>(0, M - 1);
+    valDist = std::uniform_int_distribution<uint32_t>();
+    writerSleepDist = std::exponential_distribution<double>(lambda_w);
+    snapshotSleepDist = std::exponential_distribution<double>(lambda_s);
+    if (benchMs) {
+        double updates, snapshots;
+        for (int which = 0; which < 2; which++) {
+            if (which) bench<HeapRegisters<uint32_t>>(benchMs, updates, snapshots);
+            else bench<SlotRegisters<uint32_t>>(benchMs, updates, snapshots);
+            std::cout << "OFSnapshot with " << (which ? HeapRegisters<uint32_t>::name : SlotRegisters<uint32_t>::name)
+                      << " registers: " << updates << " updates/s, " << snapshots << " snapshots/s\n";
+        }
+        return 0;
+    }
+    if (regs == SlotRegisters<uint32_t>::name) runTest<SlotRegisters<uint32_t>>(fout);
+    else runTest<HeapRegisters<uint32_t>>(fout);
     return 0;
-}
\ No newline at end of file
+}
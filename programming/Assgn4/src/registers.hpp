@@ -0,0 +1,179 @@
+/**
+ * @author Gautam Singh
+ * @file registers.hpp
+ * @brief Stamped values and the shared arrays of registers holding them, for
+ * the snapshot objects. A snapshot object takes the kind of its registers as a
+ * template parameter.
+ *
+ * Registers: HeapRegisters, SlotRegisters.
+ *
+ * @date 2026-10-17
+ */
+
+#pragma once
+
+// Headers
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <immintrin.h>
+
+// Classes and structs
+
+/**
+ * @brief An implementation of a timestamped value. It contains a value and a
+ * timestamp.
+ */
+template<class T>
+struct StampedValue {
+    T value;        // Value stored
+    uint16_t id;    // Thread id
+    uint64_t stamp; // Timestamp, which does not wrap around
+
+    /**
+     * @brief Constructor method for StampedValue.
+     * @param val Value.
+     * @param ts Timestamp.
+     * @param tid Thread id.
+     */
+    StampedValue(T val = 0, uint64_t ts = 0, uint16_t tid = 0) : value(val), id(tid), stamp(ts) {}
+
+    bool operator == (const StampedValue<T> stval) const {
+        return value == stval.value and stamp == stval.stamp and id == stval.id;
+    }
+
+    bool operator != (const StampedValue<T> stval) const {
+        return !(*this == stval);
+    }
+};
+
+template<class T> using P = std::atomic<StampedValue<T> *>;
+
+/**
+ * @class Shared array whose registers are allocated on the heap, and replaced
+ * by a new allocation on every write. A replaced register may still be read by
+ * other threads, so its writer keeps it on a retire list of its own, and all of
+ * them are freed when the array is destroyed. Memory thus grows with the
+ * number of writes.
+ * @param m Size of the shared array.
+ * @param w Number of writers, with ids 0 to w - 1.
+ */
+template<class T>
+class HeapRegisters {
+private:
+    /**
+     * @brief Registers replaced by a writer, on a cache line of its own.
+     */
+    struct alignas(64) Retired {
+        std::vector<StampedValue<T> *> regs;
+    };
+
+    std::vector<P<T>> shArr;
+    std::vector<Retired> retired;
+public:
+    static constexpr const char *name = "heap";
+
+    HeapRegisters(int m, int w) : shArr(m), retired(w) { for (auto &u : shArr) u = new StampedValue<T>(0, 0, 0); }
+    HeapRegisters(const HeapRegisters &) = delete;
+    ~HeapRegisters() {
+        for (auto &u : shArr) delete u.load();
+        for (auto &r : retired) for (auto *u : r.regs) delete u;
+    }
+
+    /**
+     * @brief Size of the shared array.
+     */
+    size_t size() const { return shArr.size(); }
+
+    /**
+     * @brief Read the register at location `l`.
+     */
+    StampedValue<T> load(int l) const { return *shArr[l]; }
+
+    /**
+     * @brief Write `sv` to the register at location `l`. The replaced register
+     * is retired by the writer `sv.id`.
+     */
+    void store(int l, StampedValue<T> sv) { retired[sv.id].regs.push_back(shArr[l].exchange(new StampedValue<T>(sv))); }
+};
+
+/**
+ * @class Shared array of fixed registers, each a 16-byte word on a cache line
+ * of its own. The value and id take the low 8 bytes of the word and the full
+ * 64-bit stamp the high 8 bytes, so stamps never wrap around. The word is
+ * written with cmpxchg16b, so writes neither allocate nor tear, and writers to
+ * different locations do not share cache lines. Processors with AVX read
+ * aligned 16-byte words atomically with a single load; others read the word
+ * with cmpxchg16b as well.
+ * @param m Size of the shared array.
+ * @param w Number of writers, which fixed registers do not need.
+ */
+template<class T>
+class SlotRegisters {
+private:
+    using Word = unsigned __int128;
+
+    /**
+     * @brief Register on a cache line of its own.
+     */
+    struct alignas(64) Slot {
+        Word word = 0;      // Packed stamped value of the register
+    };
+
+    static_assert(sizeof(T) <= 6 && std::is_trivially_copyable_v<T>, "values must fit in 6 bytes");
+
+    mutable std::vector<Slot> slots;
+    const bool atomicLoads = __builtin_cpu_supports("avx");     // Whether 16-byte loads are atomic
+
+    static Word pack(StampedValue<T> sv) {
+        uint64_t low = 0;
+        std::memcpy(&low, &sv.value, sizeof(T));
+        return (Word)sv.stamp << 64 | (Word)sv.id << 48 | low;
+    }
+
+    __attribute__((target("cx16")))
+    static Word cas(Word *p, Word expected, Word desired) { return __sync_val_compare_and_swap(p, expected, desired); }
+
+    static StampedValue<T> unpack(Word w) {
+        StampedValue<T> sv(0, (uint64_t)(w >> 64), (uint16_t)(w >> 48));
+        uint64_t low = (uint64_t)w;
+        std::memcpy(&sv.value, &low, sizeof(T));
+        return sv;
+    }
+public:
+    static constexpr const char *name = "slot";
+
+    SlotRegisters(int m, int) : slots(m) {}
+
+    /**
+     * @brief Size of the shared array.
+     */
+    size_t size() const { return slots.size(); }
+
+    /**
+     * @brief Read the register at location `l`, with a single load, or else
+     * a compare-and-swap that leaves it unchanged. Writes are locked, so
+     * registers are sequentially consistent, as the double collect assumes.
+     */
+    StampedValue<T> load(int l) const {
+        if (!atomicLoads) return unpack(cas(&slots[l].word, 0, 0));
+        __m128i x;
+        asm volatile("movdqa %1, %0" : "=x"(x) : "m"(slots[l].word) : "memory");
+        Word w;
+        std::memcpy(&w, &x, sizeof(w));
+        return unpack(w);
+    }
+
+    /**
+     * @brief Write `sv` to the register at location `l`. A single
+     * compare-and-swap is tried, so writes are wait-free: if it fails, another
+     * write landed since the word was read, and this write takes effect just
+     * before it, overwritten at once.
+     */
+    void store(int l, StampedValue<T> sv) {
+        Word old = pack(load(l));
+        cas(&slots[l].word, old, pack(sv));
+    }
+};
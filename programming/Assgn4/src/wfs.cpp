@@ -20,41 +20,11 @@
 #include <random>
 #include <thread>
 #include <atomic>
-#include <unordered_map>
-#include <unordered_set>
+#include <sstream>
+#include "registers.hpp"
 
 // Classes and structs
 
-/**
- * @brief An implementation of a timestamped value. It contains a value and a
- * timestamp.
- */
-template<class T>
-struct StampedValue {
-    T value;        // Value stored
-    uint16_t stamp; // Timestamp
-    uint16_t id;    // Thread id
-
-    /**
-     * @brief Constructor method for StampedValue.
-     * @param val Value.
-     * @param ts Timestamp.
-     * @param tid Thread id.
-     */
-    StampedValue(T val, uint16_t ts, uint16_t tid) : value(val), stamp(ts), id(tid) {}
-
-    bool operator == (const StampedValue<T> stval) const {
-        return value == stval.value and stamp == stval.stamp and id == stval.id;
-    }
-
-    bool operator != (const StampedValue<T> stval) const {
-        return !(*this == stval);
-    }
-};
-
-template<class T> using A = std::atomic<StampedValue<T>>;
-template<class T> using P = std::unique_ptr<A<T>>;
-
 /**
  * @brief A struct containing relevant information carried by a log.
  */
@@ -88,82 +58,171 @@ struct Log {
     }
 };
 
-thread_local uint16_t sn = 0;
+thread_local uint64_t sn = 0;
 
 /**
  * @class Implementation of wait-free MRMW snapshot interface.
  * @param m Size of the shared array.
+ * @param n Number of threads using the object, with ids 0 to n - 1.
+ * @param w Number of writers among them, with ids 0 to w - 1.
+ * @param R Registers of the shared array, from registers.hpp.
  */
-template<typename T>
+template<typename T, class R = SlotRegisters<T>>
 class WFSnapshot {
 private:
-    std::vector<P<T>> shArr;
-    std::unordered_map<int, std::vector<T>> helpSnap;
-public:
-    WFSnapshot(int m) : shArr(m) { for (auto &u : shArr) u = std::make_unique<A<T>>(StampedValue<T>(0, 0, 0)); }
+    static constexpr int INDEX_SHIFT = 48;                          // Position of the buffer in a view
+    static constexpr uint64_t PINS = (uint64_t(1) << INDEX_SHIFT) - 1;  // Pins of the buffer in a view
 
     /**
-     * @brief Set the value at memory location `l` to `v`.
-     * @param l Location whose value is to be updated.
-     * @param v New value to be inserted at location `l`.
+     * @brief Helping snapshots of a writer, in a pool of n + 1 preallocated
+     * buffers. The view holds the published buffer and the number of threads
+     * that pinned it while it was published, so that pinning the latest
+     * helping snapshot is a single fetch-and-add. When the writer publishes
+     * another buffer, it moves the pins of the old one to its counter, which
+     * the threads decrement once done. The other n - 1 threads pin at most one
+     * buffer each, so the writer always finds a free buffer among the rest.
      */
-    void update(int l, T v) {
-        // Get hashed thread id
-        uint16_t tid = std::hash<std::thread::id>{}(std::this_thread::get_id());
-        // Replace memory location with new value.
-        shArr[l] = std::make_unique<A<T>>(StampedValue<T>(v, ++sn, tid));
-        // Perform snapshot to help others.
-        helpSnap[tid] = snapshot();
+    struct alignas(64) Helper {
+        std::atomic<uint64_t> view{0};          // Published buffer and its pins
+        std::vector<T> pool;                    // Buffers of m values each
+        std::vector<std::atomic<int64_t>> pins; // Pins left on each buffer no longer published
+        size_t next = 0;                        // Buffer to try first
+    };
+
+    /**
+     * @brief Buffers of the scans of a thread, allocated once.
+     */
+    struct alignas(64) Scratch {
+        std::vector<StampedValue<T>> oldCopy, newCopy;  // Collects
+        std::vector<uint64_t> moved;                    // Scan in which each writer last moved
+        uint64_t scans = 0;                             // Number of scans
+    };
+
+    R shArr;
+    size_t m, n;
+    std::vector<Helper> helpers;
+    std::vector<Scratch> scratch;
+
+    /**
+     * @brief Copy the latest helping snapshot of writer `tid` into `out`. It
+     * is pinned and unpinned with one atomic operation each, without retries.
+     * @param tid Id of the writer.
+     * @param out Copy of the helping snapshot.
+     */
+    void borrow(uint16_t tid, T *out) {
+        Helper &h = helpers[tid];
+        size_t b = h.view.fetch_add(1, std::memory_order_acquire) >> INDEX_SHIFT;
+        std::copy(&h.pool[b * m], &h.pool[b * m] + m, out);
+        h.pins[b].fetch_sub(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Find a buffer of writer `id` that is neither published nor
+     * pinned, within n + 1 tries.
+     * @param id Id of the writer.
+     * @return Index of the free buffer.
+     */
+    size_t freeBuffer(uint16_t id) {
+        Helper &h = helpers[id];
+        size_t published = h.view.load(std::memory_order_relaxed) >> INDEX_SHIFT;
+        while (true) {
+            size_t b = h.next;
+            h.next = (h.next + 1) % (n + 1);
+            if (b != published && !h.pins[b].load(std::memory_order_acquire)) return b;
+        }
+    }
+
+    /**
+     * @brief Publish buffer `b` of writer `id`, and move the pins of the
+     * buffer it replaces to its counter.
+     * @param id Id of the writer.
+     * @param b Index of the buffer.
+     */
+    void publish(uint16_t id, size_t b) {
+        Helper &h = helpers[id];
+        uint64_t old = h.view.exchange(uint64_t(b) << INDEX_SHIFT, std::memory_order_acq_rel);
+        h.pins[old >> INDEX_SHIFT].fetch_add(old & PINS, std::memory_order_relaxed);
     }
 
     /**
      * @brief Helper function to collect the contents of the shared array.
-     * @return Array of stamped values representing the contents of the shared
-     * array.
+     * @param copy Array of stamped values representing the contents of the
+     * shared array.
      */
-    std::vector<StampedValue<T>> collect() {
-        std::vector<StampedValue<T>> copy;
-        for (P<T> &u : shArr) copy.push_back(*u);
-        return copy;
+    void collect(std::vector<StampedValue<T>> &copy) {
+        for (size_t l = 0; l < m; l++) copy[l] = shArr.load(l);
     }
 
     /**
-     * @brief Return a linearizable snapshot of the shared array.
-     * @return Snapshot consisting of the values stored in the shared array
+     * @brief Take a linearizable snapshot of the shared array, without locks
+     * or allocations.
+     * @param id Id of the calling thread.
+     * @param out Snapshot consisting of the values stored in the shared array
      * which is linearizable within the interval of this function.
      */
-    std::vector<T> snapshot() {
-        // Maintain a list of threads that moved
-        std::unordered_set<uint16_t> can_help;
-        std::vector<StampedValue<T>> oldCopy, newCopy;
+    void scan(uint16_t id, T *out) {
+        Scratch &sc = scratch[id];
+        // Threads that moved in this scan are marked with its number
+        uint64_t mark = ++sc.scans;
         // Perform initial collect
-        oldCopy = collect();
+        collect(sc.oldCopy);
         while (true) {
             // Perform second collect
-            newCopy = collect();
-            int m = oldCopy.size();
+            collect(sc.newCopy);
             bool ok = true;
             // Check if the collects match
-            for (int i = 0; i < m; i++) {
-                if (oldCopy[i] != newCopy[i]) {
+            for (size_t i = 0; i < m; i++) {
+                if (sc.oldCopy[i] != sc.newCopy[i]) {
                     ok = false;
-                    uint16_t tid = newCopy[i].id;
-                    if (can_help.count(tid)) return helpSnap[tid];  // This thread moved twice
-                    else can_help.insert(tid);  // This thread moved for the first time
+                    uint16_t tid = sc.newCopy[i].id;
+                    if (sc.moved[tid] == mark) return borrow(tid, out);  // This thread moved twice
+                    else sc.moved[tid] = mark;  // This thread moved for the first time
                 }
             }
             if (!ok) {
                 // Swap first collect with second collect
-                std::swap(oldCopy, newCopy);
+                std::swap(sc.oldCopy, sc.newCopy);
                 // Redo second collect
                 continue;
             }
             // We have a clean collect
-            std::vector<T> ret;
-            for (StampedValue<T> u : newCopy) ret.push_back(u.value);
-            return ret;
+            for (size_t i = 0; i < m; i++) out[i] = sc.newCopy[i].value;
+            return;
         }
     }
+public:
+    WFSnapshot(int m, int n, int w) : shArr(m, w), m(m), n(n), helpers(w), scratch(n) {
+        // Only writers publish helping snapshots
+        for (auto &h : helpers) h.pool.resize((n + 1) * m), h.pins = std::vector<std::atomic<int64_t>>(n + 1);
+        for (auto &sc : scratch) sc.oldCopy.resize(m), sc.newCopy.resize(m), sc.moved.resize(w);
+    }
+
+    /**
+     * @brief Set the value at memory location `l` to `v`.
+     * @param l Location whose value is to be updated.
+     * @param v New value to be inserted at location `l`.
+     * @param id Id of the calling thread, a writer.
+     */
+    void update(int l, T v, uint16_t id) {
+        // Replace memory location with new value.
+        shArr.store(l, StampedValue<T>(v, ++sn, id));
+        // Perform snapshot to help others, and publish it.
+        size_t b = freeBuffer(id);
+        scan(id, &helpers[id].pool[b * m]);
+        publish(id, b);
+    }
+
+    /**
+     * @brief Return a linearizable snapshot of the shared array.
+     * @param id Id of the calling thread.
+     * @return Snapshot consisting of the values stored in the shared array
+     * which is linearizable within the interval of this function.
+     */
+    std::vector<T> snapshot(uint16_t id) {
+        std::vector<T> ret(m);
+        scan(id, ret.data());
+        return ret;
+    }
 };
 
 // Global variables
@@ -183,8 +242,8 @@ const char* OUTFILE = "out.txt";
 
 // Runner functions
 
-template<class T>
-void writerThreadRunner(uint16_t id, WFSnapshot<T> &snapObj, std::vector<Log> &log) {
+template<class T, class R>
+void writerThreadRunner(uint16_t id, WFSnapshot<T, R> &snapObj, std::vector<Log> &log) {
     std::stringstream ss;
     while (!term) {
         // Get l, v
@@ -192,7 +251,7 @@ void writerThreadRunner(uint16_t id, WFSnapshot<T> &snapObj, std::vector<Log> &l
         T v = valDist(rng);
         // Perform write
         auto writeStart = std::chrono::system_clock::now();
-        snapObj.update(l, v);
+        snapObj.update(l, v, id);
         auto writeEnd = std::chrono::system_clock::now();
         // Log write with timestamp
         ss.str(std::string());
@@ -206,13 +265,13 @@ void writerThreadRunner(uint16_t id, WFSnapshot<T> &snapObj, std::vector<Log> &l
     }
 }
 
-template<class T>
-void snapshotThreadRunner(uint16_t id, WFSnapshot<T> &snapObj, std::vector<Log> &log) {
+template<class T, class R>
+void snapshotThreadRunner(uint16_t id, WFSnapshot<T, R> &snapObj, std::vector<Log> &log) {
     std::stringstream ss;
     for (uint32_t i = 0; i < k; i++) {
         // Do the snapshot
         auto collectStart = std::chrono::system_clock::now();
-        std::vector<T> snap = snapObj.snapshot();
+        std::vector<T> snap = snapObj.snapshot(nw + id);
         auto collectEnd = std::chrono::system_clock::now();
         // Log snapshot
         ss.str(std::string());
@@ -227,24 +286,13 @@ void snapshotThreadRunner(uint16_t id, WFSnapshot<T> &snapObj, std::vector<Log>
     }
 }
 
-int main(int argc, char *argv []) {
-    // Input parsing
-    std::fstream fin(INFILE, std::fstream::in);
-    if (!fin) {
-        std::cerr << "[ERROR] Input file " << INFILE << " not found.\n";
-        return 1;
-    }
-    std::fstream fout(OUTFILE, std::fstream::out);
-    if (!fout) {
-        std::cerr << "[ERROR] Could not create output file " << OUTFILE << ".\n";
-        return 1;
-    }
-    fin >> nw >> ns >> M >> lambda_w >> lambda_s >> k;
-    // Set up the generators
-    locDist = std::uniform_int_distribution<uint32_t>(0, M - 1);
-    valDist = std::uniform_int_distribution<uint32_t>();
-    writerSleepDist = std::exponential_distribution<double>(lambda_w);
-    snapshotSleepDist = std::exponential_distribution<double>(lambda_s);
+/**
+ * @brief Run nw writer and ns snapshot threads on a snapshot object, and write
+ * their logs in order of time.
+ * @param fout Output file stream.
+ */
+template<class R>
+void runTest(std::fstream &fout) {
     // Set up the termination flag
     term = false;
     // Create threads
@@ -252,12 +300,12 @@ int main(int argc, char *argv []) {
     // Create loggers
     std::vector<std::vector<Log>> writerLogs(nw, std::vector<Log>()), snapshotLogs(ns, std::vector<Log>());
     // Create WFS object
-    WFSnapshot<uint32_t> snapObj(M);
+    WFSnapshot<uint32_t, R> snapObj(M, nw + ns, nw);
     for (uint16_t i = 0; i < nw; i++) {
-        writerThreads[i] = std::thread{writerThreadRunner<uint32_t>, i, std::ref(snapObj), std::ref(writerLogs[i])};
+        writerThreads[i] = std::thread{writerThreadRunner<uint32_t, R>, i, std::ref(snapObj), std::ref(writerLogs[i])};
     }
     for (uint16_t i = 0; i < ns; i++) {
-        snapshotThreads[i] = std::thread{snapshotThreadRunner<uint32_t>, i, std::ref(snapObj), std::ref(snapshotLogs[i])};
+        snapshotThreads[i] = std::thread{snapshotThreadRunner<uint32_t, R>, i, std::ref(snapObj), std::ref(snapshotLogs[i])};
     }
     for (auto &th : snapshotThreads) th.join();
     term = true;
@@ -268,5 +316,100 @@ int main(int argc, char *argv []) {
     for (auto &lg : snapshotLogs) out.insert(out.end(), lg.begin(), lg.end());
     sort(out.begin(), out.end());
     for (auto &lg : out) fout << lg;
+}
+
+/**
+ * @brief Measure the throughput of a snapshot object: nw writer threads update
+ * random locations and ns snapshot threads take snapshots, back to back, for
+ * `ms` milliseconds.
+ * @param ms Duration of the measurement in milliseconds.
+ * @param updates Populated with the updates per second.
+ * @param snapshots Populated with the snapshots per second.
+ */
+template<class R>
+void bench(int ms, double &updates, double &snapshots) {
+    /**
+     * @brief Count of operations of a thread, on a cache line of its own.
+     */
+    struct alignas(64) Count {
+        uint64_t ops = 0;
+    };
+
+    WFSnapshot<uint32_t, R> snapObj(M, nw + ns, nw);
+    std::atomic<bool> stop = false;
+    std::vector<Count> counts(nw + ns);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < nw + ns; i++) {
+        threads.emplace_back([&, i] {
+            // Every thread draws its locations and values from its own generator
+            std::mt19937 gen(i);
+            auto loc = locDist;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (i < nw) snapObj.update(loc(gen), gen(), i);
+                else snapObj.snapshot(i);
+                counts[i].ops++;
+            }
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    stop = true;
+    for (auto &th : threads) th.join();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    updates = snapshots = 0;
+    for (uint32_t i = 0; i < nw + ns; i++) (i < nw ? updates : snapshots) += counts[i].ops / secs;
+}
+
+int main(int argc, char *argv []) {
+    // Parse options
+    std::string regs = SlotRegisters<uint32_t>::name;
+    int benchMs = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-r" || arg == "--registers") && i + 1 < argc) {
+            regs = argv[++i];
+        } else if ((arg == "-b" || arg == "--bench") && i + 1 < argc) {
+            benchMs = std::stoi(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [options]\n\n"
+                      << "Options:\n"
+                      << "  -r,--registers {slot|heap}  Use fixed atomic registers, or registers reallocated on every write (default slot)\n"
+                      << "  -b,--bench <MS>             Compare the throughput with both kinds of registers for MS milliseconds each, and exit\n";
+            return 1;
+        }
+    }
+    if (regs != SlotRegisters<uint32_t>::name && regs != HeapRegisters<uint32_t>::name) {
+        std::cerr << "[ERROR] Unknown registers " << regs << ".\n";
+        return 1;
+    }
+    // Input parsing
+    std::fstream fin(INFILE, std::fstream::in);
+    if (!fin) {
+        std::cerr << "[ERROR] Input file " << INFILE << " not found.\n";
+        return 1;
+    }
+    std::fstream fout(OUTFILE, std::fstream::out);
+    if (!fout) {
+        std::cerr << "[ERROR] Could not create output file " << OUTFILE << ".\n";
+        return 1;
+    }
+    fin >> nw >> ns >> M >> lambda_w >> lambda_s >> k;
+    // Set up the generators
+    locDist = std::uniform_int_distribution<uint32_t>(0, M - 1);
+    valDist = std::uniform_int_distribution<uint32_t>();
+    writerSleepDist = std::exponential_distribution<double>(lambda_w);
+    snapshotSleepDist = std::exponential_distribution<double>(lambda_s);
+    if (benchMs) {
+        double updates, snapshots;
+        for (int which = 0; which < 2; which++) {
+            if (which) bench<HeapRegisters<uint32_t>>(benchMs, updates, snapshots);
+            else bench<SlotRegisters<uint32_t>>(benchMs, updates, snapshots);
+            std::cout << "WFSnapshot with " << (which ? HeapRegisters<uint32_t>::name : SlotRegisters<uint32_t>::name)
+                      << " registers: " << updates << " updates/s, " << snapshots << " snapshots/s\n";
+        }
+        return 0;
+    }
+    if (regs == SlotRegisters<uint32_t>::name) runTest<SlotRegisters<uint32_t>>(fout);
+    else runTest<HeapRegisters<uint32_t>>(fout);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,145 @@
+/**
+ * @author Gautam Singh (CS21BTECH11018)
+ * @file bench.cpp
+ * @brief Benchmark of the reductions of engine.hpp against the zero count, on
+ * a random matrix generated in memory. Every reduction is run with every
+ * technique of the chosen library, and its median time is reported next to
+ * that of the zero count with the same technique.
+ *
+ * @date 2026-10-17
+ */
+
+// Headers
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include "engine.hpp"
+
+// Global variables
+
+uint64_t N = 4096, S = 50, K = std::max(std::thread::hardware_concurrency(), 1u), rowInc = 16, RUNS = 11;
+
+/**
+ * @brief Time a reduction.
+ * @param m Reduction.
+ * @param A Matrix to reduce.
+ * @param e Entry of the technique and library to use.
+ * @return Median time of RUNS runs in microseconds, after a warmup run.
+ */
+template<class M>
+double timeReduction(const M &m, const sparsity::MatrixView<typename M::element_type> &A, const sparsity::Entry<M> &e) {
+    std::vector<double> times;
+    for (uint64_t r = 0; r <= RUNS; r++) {
+        auto startTime = std::chrono::steady_clock::now();
+        auto res = e.reduce(m, A, K, rowInc);
+        auto endTime = std::chrono::steady_clock::now();
+        // Keep the result alive so that the reduction is not optimized away
+        asm volatile("" : : "r"(res.data()) : "memory");
+        if (r) times.push_back(std::chrono::duration<double, std::micro>(endTime - startTime).count());
+    }
+    std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+    return times[times.size() / 2];
+}
+
+/**
+ * @brief Benchmark every reduction with every technique of a library.
+ * @param lib Name of the library.
+ */
+template<class T>
+void bench(const std::string &lib) {
+    using namespace sparsity;
+    // Generate the matrix
+    std::mt19937_64 gen(N * 100 + S);
+    std::uniform_int_distribution<int> val(1, 100), pct(0, 99);
+    std::vector<T> data(N * N);
+    for (T &v : data) v = (uint64_t)pct(gen) < S ? 0 : (T)val(gen);
+    MatrixView<T> A{data.data(), N, N};
+    std::cout << "N = " << N << ", S = " << S << "%, K = " << K << ", rowInc = " << rowInc
+              << ", library = " << lib << ", median of " << RUNS << " runs\n\n"
+              << std::left << std::setw(18) << "technique";
+    for (auto name : {"zeros", "sum", "minmax", "hist", "rownnz"}) std::cout << std::right << std::setw(18) << name;
+    std::cout << '\n' << std::fixed << std::setprecision(1);
+    for (auto &z : TABLE<ZeroCount<T>>) {
+        if (z.backend != lib) continue;
+        double base = timeReduction(ZeroCount<T>{}, A, z);
+        std::string tech(z.schedule);
+        if (!z.grain.empty()) tech += ':' + std::string(z.grain);
+        std::cout << std::left << std::setw(18) << tech << std::right << std::setw(15) << base << " us";
+        auto column = [&](const auto &m) {
+            using M = std::remove_cvref_t<decltype(m)>;
+            double t = timeReduction(m, A, *find<M>(z.backend, z.schedule, z.grain));
+            std::cout << std::setw(10) << t << " (" << std::setprecision(2) << t / base << "x)" << std::setprecision(1);
+        };
+        column(Sum<T>{});
+        column(MinMax<T>{});
+        column(Histogram<T>(0, 101, 10));
+        column(RowNnz<T>(N));
+        std::cout << std::endl;
+    }
+}
+
+/**
+ * @brief Function to print program help.
+ * @param name Name of executable, usually argv[0].
+ */
+void help(std::string name) {
+    std::cerr << "Usage: " << name << " [options]\n\n"
+              << "Options:\n"
+              << "  -h,--help                               Display this information\n"
+              << "  -n,--size      <N>                      Benchmark an N x N matrix (default " << N << ")\n"
+              << "  -s,--sparsity  <S>                      Make S percent of the elements zero (default " << S << ")\n"
+              << "  -k,--threads   <K>                      Use K threads (default " << K << ")\n"
+              << "  -i,--row-inc   <R>                      Claim R rows at a time in dynamic techniques (default " << rowInc << ")\n"
+              << "  -r,--runs      <R>                      Report the median of R runs (default " << RUNS << ")\n"
+              << "  -l,--library   {std|pthreads|omp|pool}  Use the specified library (default pool)\n"
+              << "  -e,--elem-type {int32|int8|float}       Store elements as the specified type (default int32)\n";
+}
+
+int main(int argc, char* argv[]) {
+    // Parse options
+    std::string lib = "pool", elemType = "int32";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            help(argv[0]);
+            return 0;
+        } else if (i + 1 == argc) {
+            help(argv[0]);
+            return 1;
+        } else if (arg == "-n" || arg == "--size") {
+            N = std::stoull(argv[++i]);
+        } else if (arg == "-s" || arg == "--sparsity") {
+            S = std::stoull(argv[++i]);
+        } else if (arg == "-k" || arg == "--threads") {
+            K = std::max<uint64_t>(std::stoull(argv[++i]), 1);
+        } else if (arg == "-i" || arg == "--row-inc") {
+            rowInc = std::stoull(argv[++i]);
+        } else if (arg == "-r" || arg == "--runs") {
+            RUNS = std::max<uint64_t>(std::stoull(argv[++i]), 1);
+        } else if (arg == "-l" || arg == "--library") {
+            lib = argv[++i];
+        } else if (arg == "-e" || arg == "--elem-type") {
+            elemType = argv[++i];
+        } else {
+            help(argv[0]);
+            return 1;
+        }
+    }
+    if (!sparsity::find<sparsity::ZeroCount<int>>(lib, "chunk")) {
+        std::cerr << "[ERROR] Unsupported library " << lib << std::endl;
+        return 1;
+    }
+    if (elemType == "int32") bench<int>(lib);
+    else if (elemType == "int8") bench<int8_t>(lib);
+    else if (elemType == "float") bench<float>(lib);
+    else {
+        std::cerr << "[ERROR] Unknown element type " << elemType << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,952 @@
+/**
+ * @author Gautam Singh (CS21BTECH11018)
+ * @file engine.hpp
+ * @brief Header-only engine reducing a matrix with several threads, merging
+ * the runners of Assgn1 (std::thread) and Assgn2 (pthreads and OpenMP). The
+ * threading backend, the schedule of the rows and the reduction are
+ * compile-time policies, so every combination is compiled into its own
+ * function with the reduction inlined into the loop over the rows. All
+ * combinations of backends and schedules are listed in a table generated at
+ * compile time, for choosing one at runtime.
+ *
+ * Backends: std::thread, pthreads, OpenMP (with -fopenmp), persistent pool.
+ * Schedules: Chunk, Mixed, Dynamic, Block (each dynamic one with a fixed, guided
+ * or adaptive grain), Steal.
+ * Reductions: zero count, sum, minimum and maximum, histogram, nonzeros per row.
+ *
+ * @date 2026-10-17
+ */
+
+#pragma once
+
+// Headers
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <string_view>
+#include <type_traits>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace sparsity {
+
+// Matrices and runs
+
+/**
+ * @brief Read-only view of a square row-major matrix, whose rows may be
+ * padded. Covers both the text input and both binary matrix formats.
+ */
+template<class T>
+struct MatrixView {
+    const T *data;      /// First element of the matrix
+    uint64_t n;         /// Number of rows (and columns)
+    uint64_t stride;    /// Number of elements between consecutive rows
+
+    /**
+     * @brief First element of a row.
+     * @param i Row index.
+     */
+    const T *row(uint64_t i) const { return data + i * stride; }
+};
+
+/**
+ * @brief Count the zeros in a range of a row. The loop is simple enough for
+ * the compiler to vectorize it in place.
+ * @param p First element of the range.
+ * @param len Number of elements in the range.
+ * @return Number of zeros in the range.
+ */
+template<class T>
+inline uint64_t countZeros(const T *p, uint64_t len) {
+    uint64_t res = 0;
+    for (uint64_t j = 0; j < len; j++) res += !p[j];
+    return res;
+}
+
+/**
+ * @brief Range of rows [lo, hi) left to a thread by the steal schedule. Both
+ * ends are packed into one word, so that the owner taking rows off the front
+ * and thieves taking half off the back each need a single CAS. Every range
+ * sits on its own cache line, so threads only contend when stealing.
+ */
+struct alignas(64) RowRange {
+    std::atomic<uint64_t> rows;     /// lo in the upper 32 bits, hi in the lower 32 bits
+
+    static uint64_t pack(uint64_t lo, uint64_t hi) { return lo << 32 | hi; }
+    static uint64_t lo(uint64_t r) { return r >> 32; }
+    static uint64_t hi(uint64_t r) { return r & 0xffffffff; }
+};
+
+/**
+ * @brief State shared by the threads of one reduction.
+ */
+template<class T>
+struct Run {
+    MatrixView<T> A;                            /// Matrix being reduced
+    uint64_t K;                                 /// Number of threads
+    uint64_t rowInc;                            /// Rows (or blocks) claimed at a time by dynamic schedules
+    alignas(64) std::atomic<uint64_t> counter;  /// Rows (or blocks) claimed so far by dynamic schedules
+    std::vector<RowRange> ranges;               /// Range of rows of each thread, for the steal schedule only
+
+    Run(const MatrixView<T> &_A, uint64_t _K, uint64_t _rowInc)
+        : A(_A), K(_K), rowInc(std::max<uint64_t>(_rowInc, 1)), counter(0) {}
+};
+
+// Reductions
+
+/*
+ * A reduction is a monoid over the elements of a matrix: identity() is the
+ * value of an empty part, combine(a, b) folds b into a, and element(a, x)
+ * folds the element x into a. A reduction may instead define
+ * row(a, p, len, i), folding the range [p, p + len) of row i at once, which is
+ * how the common reductions are vectorized, and how reductions keyed by row
+ * get the index.
+ */
+
+/**
+ * @brief Lanes of the vectorized reductions. Folding into this many
+ * independent accumulators lets the compiler vectorize reductions it may not
+ * reorder, such as floating point sums.
+ */
+constexpr uint64_t LANES = 8;
+
+/**
+ * @brief Fold a range of a row into an accumulator.
+ * @param m Reduction.
+ * @param acc Accumulator.
+ * @param p First element of the range.
+ * @param len Number of elements in the range.
+ * @param i Row index.
+ */
+template<class M, class T>
+inline void foldRow(const M &m, typename M::value_type &acc, const T *p, uint64_t len, uint64_t i) {
+    if constexpr (requires { m.row(acc, p, len, i); }) m.row(acc, p, len, i);
+    else for (uint64_t j = 0; j < len; j++) m.element(acc, p[j]);
+}
+
+/**
+ * @brief Number of zeros, the reduction of Assgn1 and Assgn2.
+ */
+template<class T>
+struct ZeroCount {
+    using element_type = T;
+    using value_type = uint64_t;
+    static constexpr std::string_view name = "zeros";
+
+    value_type identity() const { return 0; }
+    void combine(value_type &a, const value_type &b) const { a += b; }
+    void element(value_type &a, T x) const { a += !x; }
+    void row(value_type &a, const T *p, uint64_t len, uint64_t) const { a += countZeros(p, len); }
+};
+
+/**
+ * @brief Sum of the elements, which is also the sum of the nonzero elements.
+ * Integers are summed exactly in 64 bits, and floating point numbers in
+ * double precision.
+ */
+template<class T>
+struct Sum {
+    using element_type = T;
+    using value_type = std::conditional_t<std::is_floating_point_v<T>, double, int64_t>;
+    static constexpr std::string_view name = "sum";
+
+    value_type identity() const { return 0; }
+    void combine(value_type &a, const value_type &b) const { a += b; }
+    void element(value_type &a, T x) const { a += x; }
+    void row(value_type &a, const T *p, uint64_t len, uint64_t) const {
+        value_type s[LANES] = {};
+        uint64_t j = 0;
+        for (; j + LANES <= len; j += LANES)
+            for (uint64_t k = 0; k < LANES; k++) s[k] += p[j + k];
+        for (; j < len; j++) s[0] += p[j];
+        for (uint64_t k = 0; k < LANES; k++) a += s[k];
+    }
+};
+
+/**
+ * @brief Smallest and largest element. The accumulator keeps them per lane,
+ * so that long ranges fold into independent lanes. Short ranges, such as the
+ * ranges of the block technique, fold into the first lane alone, so that they
+ * do not pay for loading and storing all the lanes. The identity is an empty
+ * range, with min() > max().
+ */
+template<class T>
+struct MinMax {
+    struct Range {
+        T mn[LANES];    /// Smallest element of each lane
+        T mx[LANES];    /// Largest element of each lane
+
+        T min() const { return *std::min_element(mn, mn + LANES); }
+        T max() const { return *std::max_element(mx, mx + LANES); }
+    };
+
+    using element_type = T;
+    using value_type = Range;
+    static constexpr std::string_view name = "minmax";
+    static constexpr uint64_t SHORT = 16 * LANES;   /// Ranges shorter than this fold into the first lane
+
+    value_type identity() const {
+        value_type r;
+        std::fill_n(r.mn, LANES, std::numeric_limits<T>::max());
+        std::fill_n(r.mx, LANES, std::numeric_limits<T>::lowest());
+        return r;
+    }
+    void combine(value_type &a, const value_type &b) const {
+        for (uint64_t k = 0; k < LANES; k++) {
+            a.mn[k] = b.mn[k] < a.mn[k] ? b.mn[k] : a.mn[k];
+            a.mx[k] = b.mx[k] > a.mx[k] ? b.mx[k] : a.mx[k];
+        }
+    }
+    void row(value_type &a, const T *p, uint64_t len, uint64_t) const {
+        if (len < SHORT) {
+            T mn = a.mn[0], mx = a.mx[0];
+            if (std::is_integral_v<T> || len < LANES) {
+                // The compiler vectorizes integer minimums by itself
+                for (uint64_t j = 0; j < len; j++) {
+                    mn = p[j] < mn ? p[j] : mn;
+                    mx = p[j] > mx ? p[j] : mx;
+                }
+            } else {
+                // Fold into lanes starting from the first LANES elements, and
+                // halve them down to one
+                T lmn[LANES], lmx[LANES];
+                std::copy_n(p, LANES, lmn), std::copy_n(p, LANES, lmx);
+                for (uint64_t j = LANES; j < len; j += LANES) {
+                    const T *q = p + std::min(j, len - LANES);
+                    for (uint64_t k = 0; k < LANES; k++) {
+                        lmn[k] = q[k] < lmn[k] ? q[k] : lmn[k];
+                        lmx[k] = q[k] > lmx[k] ? q[k] : lmx[k];
+                    }
+                }
+                for (uint64_t w = LANES / 2; w; w /= 2)
+                    for (uint64_t k = 0; k < w; k++) {
+                        lmn[k] = lmn[k + w] < lmn[k] ? lmn[k + w] : lmn[k];
+                        lmx[k] = lmx[k + w] > lmx[k] ? lmx[k + w] : lmx[k];
+                    }
+                mn = lmn[0] < mn ? lmn[0] : mn;
+                mx = lmx[0] > mx ? lmx[0] : mx;
+            }
+            a.mn[0] = mn, a.mx[0] = mx;
+            return;
+        }
+        // Fold into a local copy, which the compiler knows does not alias the row
+        value_type r = a;
+        uint64_t j = 0;
+        for (; j + LANES <= len; j += LANES)
+            for (uint64_t k = 0; k < LANES; k++) {
+                r.mn[k] = p[j + k] < r.mn[k] ? p[j + k] : r.mn[k];
+                r.mx[k] = p[j + k] > r.mx[k] ? p[j + k] : r.mx[k];
+            }
+        // Fold the last LANES elements again, as min and max are idempotent
+        j = len - LANES;
+        for (uint64_t k = 0; k < LANES; k++) {
+            r.mn[k] = p[j + k] < r.mn[k] ? p[j + k] : r.mn[k];
+            r.mx[k] = p[j + k] > r.mx[k] ? p[j + k] : r.mx[k];
+        }
+        a = r;
+    }
+};
+
+/**
+ * @brief Histogram of the elements over bins of equal width covering
+ * [lo, hi). Elements outside the range are counted in the first or the last
+ * bin. When T is integral, lo and hi - 1 are values of T at most RANGE apart
+ * and there are fewer bins than values in the range, the bin of an element is
+ * computed exactly with a 32-bit multiply and shift; otherwise it is computed
+ * in double precision.
+ *
+ * The bin of an element never decreases with the element, so with at most
+ * FEW_BINS bins, the elements of a range are instead compared with the
+ * smallest element of every bin, counting how many reach each bin in a
+ * vectorized loop like the zero count, with counters as wide as the elements.
+ * A vector compares fewer wide elements at once, so they get fewer bins.
+ * With more bins, the bins of the elements are found in a vectorized loop and
+ * counted into SUBS sub-histograms in turn, so that increments of the same bin
+ * do not wait on each other. The accumulator holds the SUBS sub-histograms of
+ * bins counts each, whose sum is the histogram, and combine() merges all the
+ * sub-histograms of b into the first one of a. The combined result thus holds
+ * the histogram in its first bins counts.
+ */
+template<class T>
+struct Histogram {
+    using element_type = T;
+    using value_type = std::vector<uint64_t>;
+    static constexpr std::string_view name = "hist";
+    static constexpr uint64_t RANGE = 1 << 16;              /// Widest range binned with integers
+    static constexpr uint64_t FEW_BINS = 32 / sizeof(T);    /// Most bins counted by comparing with their edges
+    static constexpr uint64_t SUBS = 4;                     /// Sub-histograms of an accumulator
+
+    double lo;              /// Lower end of the first bin
+    double scale;           /// Bins per unit
+    uint64_t bins;          /// Number of bins, below 2^31
+    bool exact;             /// Whether bins are computed with integers
+    T tlo, thi;             /// Lowest and highest element of the range, if exact
+    uint32_t range;         /// Number of elements in the range, if exact
+    uint32_t mul;           /// ceil(bins * 2^32 / range), if exact
+    uint64_t edges;         /// Number of bins after the first that some element falls in
+    T edge[FEW_BINS];       /// Smallest element of each of these bins, from the second one
+
+    Histogram(double _lo, double hi, uint64_t _bins)
+        : lo(_lo), scale(_bins / std::max(hi - _lo, 1e-300)), bins(std::clamp<uint64_t>(_bins, 1, INT32_MAX)),
+          exact(false), tlo(0), thi(0), range(1), mul(0), edges(0), edge{} {
+        // floor(d * bins / range) == d * mul >> 32 for all d < range, as long
+        // as range * (range - 1) < 2^32
+        using L = std::numeric_limits<T>;
+        if constexpr (std::is_integral_v<T>) {
+            exact = lo == std::floor(lo) && hi == std::floor(hi) && hi - lo <= RANGE && hi - lo > bins
+                    && lo >= (double)L::min() && hi - 1 <= (double)L::max();
+        }
+        if (exact) {
+            tlo = lo, thi = hi - 1, range = hi - lo;
+            mul = ((bins << 32) + range - 1) / range;
+        }
+        if (bins <= FEW_BINS) {
+            T top = L::has_infinity ? L::infinity() : L::max();
+            edges = bin(top);
+            for (uint64_t k = 1; k <= edges; k++) edge[k - 1] = smallest(k, top);
+        }
+    }
+
+    value_type identity() const { return value_type(SUBS * bins); }
+    void combine(value_type &a, const value_type &b) const {
+        for (uint64_t s = 0; s < SUBS; s++)
+            for (uint64_t k = 0; k < bins; k++) a[k] += b[s * bins + k];
+    }
+    uint32_t exactBin(T x) const {
+        uint32_t d = x < tlo ? 0 : x > thi ? range - 1 : (uint32_t)x - (uint32_t)tlo;
+        return (uint64_t)d * mul >> 32;
+    }
+    uint32_t scaledBin(T x) const {
+        double b = (x - lo) * scale;
+        b = b < 0 ? 0 : b;
+        return (int32_t)(b < bins - 1 ? b : bins - 1);
+    }
+    uint32_t bin(T x) const { return exact ? exactBin(x) : scaledBin(x); }
+    void element(value_type &a, T x) const { a[bin(x)]++; }
+    void row(value_type &a, const T *p, uint64_t len, uint64_t) const {
+        if (bins <= FEW_BINS) compare(a, p, len);
+        else if (exact) count(a, p, len, [this](T x) { return exactBin(x); });
+        else count(a, p, len, [this](T x) { return scaledBin(x); });
+    }
+
+private:
+    /**
+     * @brief Smallest element whose bin is at least k, given that the bin of
+     * `top` is.
+     */
+    T smallest(uint64_t k, T top) const {
+        if constexpr (std::is_integral_v<T>) {
+            T l = std::numeric_limits<T>::min(), r = top;
+            while (l < r) {
+                T mid = std::midpoint(l, r);
+                if (bin(mid) >= k) r = mid;
+                else l = mid + 1;
+            }
+            return l;
+        } else {
+            // Start from the rounded edge, which is off by a few ulps at most
+            T e = lo + k / scale;
+            if (!(e == e)) e = top;
+            while (bin(e) < k) e = std::nextafter(e, top);
+            for (T d = std::nextafter(e, -top); bin(d) >= k && d != e; d = std::nextafter(e, -top)) e = d;
+            return e;
+        }
+    }
+
+    /**
+     * @brief Count a range by comparing its elements with the bin edges.
+     */
+    void compare(value_type &a, const T *p, uint64_t len) const {
+        // Counters as wide as the elements, so that the comparisons vectorize
+        // without widening them
+        using C = std::conditional_t<sizeof(T) == 1, uint8_t, std::conditional_t<sizeof(T) == 2, uint16_t,
+                  std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+        constexpr uint64_t BATCH = std::min<uint64_t>(std::numeric_limits<C>::max(), 1024);
+        uint64_t reach[FEW_BINS + 1] = {};  // Elements reaching each bin
+        for (uint64_t j = 0; j < len; j += BATCH) {
+            uint64_t n = std::min(BATCH, len - j);
+            reach[0] += n;
+            for (uint64_t k = 0; k < edges; k++) {
+                C c = 0;
+                T e = edge[k];
+                for (uint64_t t = 0; t < n; t++) c += !(p[j + t] < e);
+                reach[k + 1] += c;
+            }
+        }
+        for (uint64_t k = 0; k < bins; k++) a[k] += reach[k] - reach[k + 1];
+    }
+
+    /**
+     * @brief Count a range into the sub-histograms.
+     */
+    template<class F>
+    void count(value_type &a, const T *p, uint64_t len, F &&binOf) const {
+        // Find the bins of a batch in a vectorized loop, then count them
+        uint32_t idx[64];
+        uint64_t *sub[SUBS];
+        for (uint64_t s = 0; s < SUBS; s++) sub[s] = a.data() + s * bins;
+        for (uint64_t j = 0; j < len; j += 64) {
+            uint64_t n = std::min<uint64_t>(64, len - j), k;
+            for (k = 0; k < n; k++) idx[k] = binOf(p[j + k]);
+            for (k = 0; k + SUBS <= n; k += SUBS)
+                for (uint64_t s = 0; s < SUBS; s++) sub[s][idx[k + s]]++;
+            for (; k < n; k++) sub[0][idx[k]]++;
+        }
+    }
+};
+
+/**
+ * @brief Number of nonzero elements of every row, as used to build the row
+ * pointers of a CSR matrix.
+ */
+template<class T>
+struct RowNnz {
+    using element_type = T;
+    using value_type = std::vector<uint64_t>;
+    static constexpr std::string_view name = "rownnz";
+
+    uint64_t n;     /// Number of rows
+
+    RowNnz(uint64_t _n) : n(_n) {}
+
+    value_type identity() const { return value_type(n); }
+    void combine(value_type &a, const value_type &b) const {
+        for (uint64_t i = 0; i < n; i++) a[i] += b[i];
+    }
+    void row(value_type &a, const T *p, uint64_t len, uint64_t i) const { a[i] += len - countZeros(p, len); }
+};
+
+/**
+ * @brief Combine the results of all threads.
+ * @param m Reduction.
+ * @param parts Result of each thread.
+ * @return Result of the whole matrix.
+ */
+template<class M>
+typename M::value_type combine(const M &m, const std::vector<typename M::value_type> &parts) {
+    typename M::value_type res = m.identity();
+    for (const auto &v : parts) m.combine(res, v);
+    return res;
+}
+
+// Schedules
+
+/*
+ * A schedule hands each thread its parts of the matrix, by calling
+ * body(i, l, r) for every range [l, r) of row i that the thread reduces. A
+ * schedule may define prepare(run), called once before the threads start, to
+ * set up state shared by them.
+ */
+
+/**
+ * @brief Grains of the dynamic schedules, choosing how much work a thread
+ * claims from the shared counter at a time.
+ */
+enum Grain { FIXED, GUIDED, ADAPTIVE };
+
+/// @brief Names of the grains
+constexpr std::string_view GRAIN_NAMES[] = {"fixed", "guided", "adaptive"};
+
+/**
+ * @brief Chooses how much work a thread of a dynamic schedule claims from the
+ * shared counter at a time, as in Assgn1 and Assgn2. With the fixed grain
+ * every claim is of `fixed` units. With the guided grain claims start large
+ * and shrink with the work left. With the adaptive grain claims are sized from
+ * the measured time per unit of work and the measured cost of a claim, so that
+ * claiming stays a small fraction of the work; they are still capped by the
+ * guided size to keep the tail balanced.
+ */
+template<Grain G>
+class ChunkSizer {
+    static constexpr double CLAIM_RATIO = 64;   /// Target ratio of work to claim time
+    static constexpr double EWMA_WEIGHT = 0.25; /// Weight of the newest measurement
+
+    using Clock = std::chrono::steady_clock;
+    uint64_t total, fixed, threads;     /// Units of work, fixed claim size, number of threads
+    uint64_t first = 0, last = 0;       /// Current claim [first, last)
+    double claimNs = 0, unitNs = 0;     /// Averaged time per claim and per unit
+    Clock::time_point claimedAt;        /// When the current claim was made
+
+    static double average(double avg, double sample) {
+        return avg ? (1 - EWMA_WEIGHT) * avg + EWMA_WEIGHT * sample : sample;
+    }
+
+public:
+    /**
+     * @brief Constructor for ChunkSizer, one per thread.
+     * @param _total Number of units of work (rows or blocks).
+     * @param _fixed Claim size for the fixed grain.
+     * @param _threads Number of threads sharing the work.
+     */
+    ChunkSizer(uint64_t _total, uint64_t _fixed, uint64_t _threads)
+        : total(_total), fixed(std::max<uint64_t>(_fixed, 1)), threads(std::max<uint64_t>(_threads, 1)) {}
+
+    /**
+     * @brief Claim the next chunk of work from the shared counter.
+     * @param ctr Shared counter of claimed units.
+     * @return First unit of the claimed chunk, which ends at `end()`.
+     */
+    uint64_t claim(std::atomic<uint64_t> &ctr) {
+        uint64_t inc = fixed;
+        if constexpr (G != FIXED) {
+            // Half of a fair share of the work left
+            uint64_t left = total - std::min(total, ctr.load(std::memory_order_relaxed));
+            inc = std::max<uint64_t>(1, left / (2 * threads));
+            // The first adaptive claim is a single unit, to time it
+            if constexpr (G == ADAPTIVE)
+                inc = unitNs ? std::clamp<uint64_t>(CLAIM_RATIO * claimNs / unitNs, 1, inc) : 1;
+        }
+        if constexpr (G != ADAPTIVE) {
+            first = ctr.fetch_add(inc, std::memory_order_relaxed);
+        } else {
+            auto start = Clock::now();
+            first = ctr.fetch_add(inc, std::memory_order_relaxed);
+            claimedAt = Clock::now();
+            claimNs = average(claimNs, std::chrono::duration<double, std::nano>(claimedAt - start).count());
+        }
+        last = std::min(first + inc, total);
+        return first;
+    }
+
+    /**
+     * @brief End of the current claim.
+     * @return One past the last unit of the claimed chunk.
+     */
+    uint64_t end() const { return last; }
+
+    /**
+     * @brief Tell the sizer that the current claim has been worked through.
+     */
+    void done() {
+        if constexpr (G == ADAPTIVE) {
+            if (first >= last) return;
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - claimedAt).count();
+            unitNs = average(unitNs, ns / (last - first));
+        }
+    }
+};
+
+/**
+ * @brief Schedule of the chunk technique: every thread counts a band of
+ * consecutive rows, the first N % K threads getting a row more.
+ */
+struct Chunk {
+    static constexpr std::string_view name = "chunk";
+
+    template<class T, class Body>
+    static void rows(Run<T> &run, uint64_t id, Body &&body) {
+        uint64_t N = run.A.n, K = run.K;
+        uint64_t l = id * (N / K) + std::min(id, N % K);
+        for (uint64_t i = l; i < std::min(N, l + N / K + (id < N % K)); i++) body(i, 0, N);
+    }
+};
+
+/**
+ * @brief Schedule of the mixed technique: thread id counts rows id, id + K,
+ * id + 2K and so on.
+ */
+struct Mixed {
+    static constexpr std::string_view name = "mixed";
+
+    template<class T, class Body>
+    static void rows(Run<T> &run, uint64_t id, Body &&body) {
+        for (uint64_t i = id; i < run.A.n; i += run.K) body(i, 0, run.A.n);
+    }
+};
+
+/**
+ * @brief Schedule of the dynamic technique: threads claim rows from a shared
+ * counter, as many at a time as the grain G says, until no rows are left.
+ */
+template<Grain G>
+struct Dynamic {
+    static constexpr std::string_view name = "dynamic";
+    static constexpr std::string_view grain = GRAIN_NAMES[G];
+
+    template<class T, class Body>
+    static void rows(Run<T> &run, uint64_t, Body &&body) {
+        uint64_t N = run.A.n;
+        ChunkSizer<G> sizer(N, run.rowInc, run.K);
+        while (run.counter.load(std::memory_order_relaxed) < N) {
+            uint64_t r = sizer.claim(run.counter);
+            for (uint64_t i = r; i < sizer.end(); i++) body(i, 0, N);
+            sizer.done();
+        }
+    }
+};
+
+/**
+ * @brief Schedule of the block technique: the matrix is tiled into blocks of
+ * about sqrt(N) x sqrt(N) elements, and threads claim blocks from a shared
+ * counter, as many at a time as the grain G says, until no blocks are left.
+ */
+template<Grain G>
+struct Block {
+    static constexpr std::string_view name = "block";
+    static constexpr std::string_view grain = GRAIN_NAMES[G];
+
+    template<class T, class Body>
+    static void rows(Run<T> &run, uint64_t, Body &&body) {
+        uint64_t N = run.A.n;
+        uint64_t blockSize = std::max<uint64_t>(std::sqrt((double)N), 1);
+        uint64_t numBlocks = (N + blockSize - 1) / blockSize, totalBlocks = numBlocks * numBlocks;
+        auto start = [&](uint64_t b) { return b * (N / numBlocks) + std::min(b, N % numBlocks); };
+        ChunkSizer<G> sizer(totalBlocks, run.rowInc, run.K);
+        while (run.counter.load(std::memory_order_relaxed) < totalBlocks) {
+            uint64_t b = sizer.claim(run.counter);
+            for (uint64_t k = b; k < sizer.end(); k++) {
+                uint64_t row = k / numBlocks, col = k % numBlocks;
+                for (uint64_t i = start(row); i < start(row + 1); i++) body(i, start(col), start(col + 1));
+            }
+            sizer.done();
+        }
+    }
+};
+
+/**
+ * @brief Schedule of the steal technique of Assgn1: every thread starts with
+ * the rows of the chunk technique and takes rowInc of them at a time off the
+ * front. Once its own rows run out, it steals the back half of the largest
+ * range left to another thread. Rows are packed in 32 bits each.
+ */
+struct Steal {
+    static constexpr std::string_view name = "steal";
+
+    template<class T>
+    static void prepare(Run<T> &run) {
+        uint64_t N = run.A.n, K = run.K;
+        run.ranges = std::vector<RowRange>(K);
+        for (uint64_t i = 0; i < K; i++) {
+            uint64_t l = i * (N / K) + std::min(i, N % K);
+            run.ranges[i].rows = RowRange::pack(l, l + N / K + (i < N % K));
+        }
+    }
+
+    /**
+     * @brief Steal the back half of the largest range of rows of another
+     * thread into the (empty) range of thread id.
+     * @return true if rows were stolen, false if no thread has rows to spare.
+     */
+    template<class T>
+    static bool steal(Run<T> &run, uint64_t id) {
+        while (true) {
+            // Look for the victim with the most rows left
+            uint64_t victim = run.K, most = 1, cur = 0;
+            for (uint64_t k = 1; k < run.K; k++) {
+                uint64_t v = (id + k) % run.K, r = run.ranges[v].rows.load();
+                if (RowRange::hi(r) - RowRange::lo(r) > most)
+                    victim = v, most = RowRange::hi(r) - RowRange::lo(r), cur = r;
+            }
+            // A single row left is finished off by its owner
+            if (victim == run.K) return false;
+            uint64_t lo = RowRange::lo(cur), hi = RowRange::hi(cur), mid = lo + (hi - lo) / 2;
+            if (run.ranges[victim].rows.compare_exchange_strong(cur, RowRange::pack(lo, mid))) {
+                run.ranges[id].rows.store(RowRange::pack(mid, hi));
+                return true;
+            }
+            // The victim moved in the meantime, look again
+        }
+    }
+
+    template<class T, class Body>
+    static void rows(Run<T> &run, uint64_t id, Body &&body) {
+        RowRange &own = run.ranges[id];
+        do {
+            uint64_t cur = own.rows.load(), lo, hi;
+            while ((lo = RowRange::lo(cur)) < (hi = RowRange::hi(cur))) {
+                // Take up to rowInc rows off the front
+                uint64_t r = std::min(lo + run.rowInc, hi);
+                if (!own.rows.compare_exchange_weak(cur, RowRange::pack(r, hi))) continue;
+                for (uint64_t i = lo; i < r; i++) body(i, 0, run.A.n);
+                cur = own.rows.load();
+            }
+        } while (steal(run, id));
+    }
+};
+
+/**
+ * @brief Grain of a schedule, empty for schedules that claim no work from a
+ * shared counter.
+ */
+template<class S>
+constexpr std::string_view grainOf() {
+    if constexpr (requires { S::grain; }) return S::grain;
+    else return "";
+}
+
+// Backends
+
+/*
+ * A backend runs job(id) once for every id in [0, K) on K threads, and
+ * returns once all of them are done.
+ */
+
+/**
+ * @brief Backend of Assgn1, starting a std::thread per id.
+ */
+struct StdThreads {
+    static constexpr std::string_view name = "std";
+
+    template<class Job>
+    static void run(uint64_t K, Job &job) {
+        std::vector<std::thread> threads;
+        for (uint64_t id = 0; id < K; id++) threads.emplace_back([&job, id] { job(id); });
+        for (auto &th : threads) th.join();
+    }
+};
+
+/**
+ * @brief Backend of Assgn2, starting a pthread per id.
+ */
+struct PThreads {
+    static constexpr std::string_view name = "pthreads";
+
+    template<class Job>
+    struct Arg {
+        Job *job;       /// Job to run
+        uint64_t id;    /// Id to run it for
+    };
+
+    template<class Job>
+    static void *start(void *arg) {
+        Arg<Job> *a = (Arg<Job> *)arg;
+        (*a->job)(a->id);
+        return NULL;
+    }
+
+    template<class Job>
+    static void run(uint64_t K, Job &job) {
+        std::vector<pthread_t> threads(K);
+        std::vector<Arg<Job>> args(K);
+        for (uint64_t id = 0; id < K; id++) {
+            args[id] = {&job, id};
+            pthread_create(&threads[id], NULL, start<Job>, &args[id]);
+        }
+        for (auto &th : threads) pthread_join(th, NULL);
+    }
+};
+
+#ifdef _OPENMP
+/**
+ * @brief Backend of Assgn2, running a parallel region of K OpenMP threads.
+ */
+struct OpenMP {
+    static constexpr std::string_view name = "omp";
+
+    template<class Job>
+    static void run(uint64_t K, Job &job) {
+        #pragma omp parallel num_threads(K)
+        job(omp_get_thread_num());
+    }
+};
+#endif
+
+/**
+ * @brief Reusable barrier for a fixed number of threads. Waiting threads spin
+ * briefly, and then park in the kernel on a futex until the last thread
+ * arrives.
+ */
+class FutexBarrier {
+    static constexpr int SPINS = 1024;  /// Checks of the phase before parking
+    const uint32_t parties;             /// Number of threads using the barrier
+    std::atomic<uint32_t> arrived = 0;  /// Threads arrived in the current phase
+    std::atomic<uint32_t> phase = 0;    /// Number of completed phases, the futex word
+
+    long futex(int op, uint32_t val) {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t *>(&phase), op, val, NULL, NULL, 0);
+    }
+
+public:
+    FutexBarrier(uint32_t n) : parties(n) {}
+
+    /**
+     * @brief Wait until all threads have arrived at the barrier.
+     */
+    void arriveAndWait() {
+        uint32_t p = phase.load(std::memory_order_acquire);
+        if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == parties) {
+            arrived.store(0, std::memory_order_relaxed);
+            phase.fetch_add(1, std::memory_order_release);
+            futex(FUTEX_WAKE_PRIVATE, INT_MAX);
+            return;
+        }
+        for (int i = 0; i < SPINS; i++) {
+            if (phase.load(std::memory_order_acquire) != p) return;
+            __builtin_ia32_pause();
+        }
+        while (phase.load(std::memory_order_acquire) == p) futex(FUTEX_WAIT_PRIVATE, p);
+    }
+};
+
+/**
+ * @brief Backend keeping K worker threads alive across reductions, parked on
+ * a futex barrier between them. The workers are started by the first one,
+ * and restarted only when K changes.
+ */
+class Pool {
+    std::vector<std::thread> workers;   /// Worker threads
+    FutexBarrier start, finish;         /// Barriers around every job
+    void (*call)(void *, uint64_t) = NULL;  /// Runs the current job for an id, NULL to stop
+    void *job = NULL;                   /// Current job
+
+    struct Stop { void operator()(Pool *p) const { delete p; } };
+    static inline std::unique_ptr<Pool, Stop> instance;  /// Pool of the last reduction
+
+    Pool(uint64_t K) : start(K + 1), finish(K + 1) {
+        for (uint64_t id = 0; id < K; id++) workers.emplace_back([this, id] {
+            while (true) {
+                start.arriveAndWait();
+                if (!call) return;
+                call(job, id);
+                finish.arriveAndWait();
+            }
+        });
+    }
+
+    ~Pool() {
+        call = NULL;
+        start.arriveAndWait();
+        for (auto &th : workers) th.join();
+    }
+
+public:
+    static constexpr std::string_view name = "pool";
+
+    template<class Job>
+    static void run(uint64_t K, Job &job) {
+        if (!instance || instance->workers.size() != K) {
+            instance.reset();
+            instance.reset(new Pool(K));
+        }
+        // One indirect call per thread per job, none per row
+        instance->call = [](void *j, uint64_t id) { (*(Job *)j)(id); };
+        instance->job = &job;
+        instance->start.arriveAndWait();
+        instance->finish.arriveAndWait();
+    }
+};
+
+// Reducing
+
+/**
+ * @brief Result of a thread, on a cache line of its own.
+ */
+template<class V>
+struct alignas(64) ThreadResult {
+    V value;    /// Reduction of the parts handed to the thread
+};
+
+/**
+ * @brief Reduce a matrix.
+ * @param m Reduction.
+ * @param A Matrix to reduce.
+ * @param K Number of threads.
+ * @param rowInc Rows (or blocks) claimed at a time by dynamic schedules.
+ * @return Result of each thread.
+ */
+template<class Backend, class Schedule, class M>
+std::vector<typename M::value_type> reduce(const M &m, const MatrixView<typename M::element_type> &A,
+                                           uint64_t K, uint64_t rowInc) {
+    using V = typename M::value_type;
+    Run<typename M::element_type> run(A, K, rowInc);
+    if constexpr (requires { Schedule::prepare(run); }) Schedule::prepare(run);
+    std::vector<ThreadResult<V>> results(K);
+    auto job = [&](uint64_t id) {
+        V acc = m.identity();
+        Schedule::rows(run, id, [&](uint64_t i, uint64_t l, uint64_t r) { foldRow(m, acc, run.A.row(i) + l, r - l, i); });
+        results[id].value = std::move(acc);
+    };
+    Backend::run(K, job);
+    std::vector<V> res(K);
+    for (uint64_t id = 0; id < K; id++) res[id] = std::move(results[id].value);
+    return res;
+}
+
+/**
+ * @brief Count the zeros of a matrix.
+ * @param A Matrix to count.
+ * @param K Number of threads.
+ * @param rowInc Rows (or blocks) claimed at a time by dynamic schedules.
+ * @return Number of zeros counted by each thread.
+ */
+template<class Backend, class Schedule, class T>
+std::vector<uint64_t> count(const MatrixView<T> &A, uint64_t K, uint64_t rowInc) {
+    return reduce<Backend, Schedule>(ZeroCount<T>{}, A, K, rowInc);
+}
+
+// Dispatch table
+
+/// @brief List of backends
+template<class... Bs> struct Backends {};
+
+/// @brief List of schedules
+template<class... Ss> struct Schedules {};
+
+#ifdef _OPENMP
+using AllBackends = Backends<StdThreads, PThreads, OpenMP, Pool>;
+#else
+using AllBackends = Backends<StdThreads, PThreads, Pool>;
+#endif
+using AllSchedules = Schedules<Chunk, Mixed, Dynamic<FIXED>, Dynamic<GUIDED>, Dynamic<ADAPTIVE>,
+                               Block<FIXED>, Block<GUIDED>, Block<ADAPTIVE>, Steal>;
+
+/**
+ * @brief Entry of the dispatch table of a reduction, for one backend and one
+ * schedule.
+ */
+template<class M>
+struct Entry {
+    std::string_view backend;       /// Name of the backend
+    std::string_view schedule;      /// Name of the schedule
+    std::string_view grain;         /// Name of the grain of the schedule, empty if it has none
+    std::vector<typename M::value_type> (*reduce)(const M &, const MatrixView<typename M::element_type> &,
+                                                  uint64_t, uint64_t);  /// Reduce with both
+};
+
+/**
+ * @brief Make the entries of every backend with every schedule.
+ */
+template<class M, class... Bs, class... Ss>
+constexpr auto makeTable(Backends<Bs...>, Schedules<Ss...>) {
+    std::array<Entry<M>, sizeof...(Bs) * sizeof...(Ss)> table{};
+    size_t k = 0;
+    auto row = [&]<class B>(B *) { ((table[k++] = Entry<M>{B::name, Ss::name, grainOf<Ss>(), reduce<B, Ss, M>}), ...); };
+    (row((Bs *)NULL), ...);
+    return table;
+}
+
+/// @brief Dispatch table of all backends and schedules, for the reduction M
+template<class M>
+inline constexpr auto TABLE = makeTable<M>(AllBackends{}, AllSchedules{});
+
+/**
+ * @brief Look up a backend and a schedule in the dispatch table of a
+ * reduction.
+ * @param backend Name of the backend.
+ * @param schedule Name of the schedule.
+ * @param grain Name of the grain, ignored by schedules without one.
+ * @return Entry of the combination, or NULL if any is unknown.
+ */
+template<class M>
+const Entry<M> *find(std::string_view backend, std::string_view schedule, std::string_view grain = "fixed") {
+    for (const Entry<M> &e : TABLE<M>)
+        if (e.backend == backend && e.schedule == schedule && (e.grain.empty() || e.grain == grain)) return &e;
+    return NULL;
+}
+
+} // namespace sparsity
@@ -0,0 +1,297 @@
+/**
+ * @author Gautam Singh (CS21BTECH11018)
+ * @file main.cpp
+ * @brief C++ source counting the sparsity of a matrix with the unified engine
+ * of engine.hpp, which runs every technique of Assgn1 and Assgn2 with every
+ * threading library. The sparsity of a matrix is defined as the number of
+ * zero entries of a matrix. The same runners compute the sum, the range, a
+ * histogram and the nonzeros per row of the matrix.
+ *
+ * Techniques implemented: Chunk, Mixed, Dynamic, Block, Steal, the dynamic ones
+ * with a fixed, guided or adaptive grain.
+ * Libraries used: std::thread, pthreads, OpenMP, persistent pool
+ *
+ * @date 2026-10-17
+ */
+
+// Headers
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "engine.hpp"
+
+// Classes and structs
+
+/**
+ * @brief Header of both binary matrix formats, that of Assgn2 ("SPMATv1",
+ * unpadded 32-bit integers) and that of Assgn1 ("SPMATv2", padded rows of any
+ * element type). Both are 64 bytes long and share their first 40 bytes.
+ */
+struct MatrixHeader {
+    char magic[8];      /// Magic bytes, "SPMATv1" or "SPMATv2"
+    uint64_t N;         /// Number of rows (and columns) of the matrix
+    uint64_t S;         /// Sparsity (in percent) of the matrix
+    uint64_t K;         /// Number of threads
+    uint64_t rowInc;    /// Row increment for dynamic techniques
+    uint64_t stride;    /// Number of elements between consecutive rows, v2 only
+    uint64_t type;      /// Type of the elements, v2 only
+    char pad[8];        /// Padding up to 64 bytes
+};
+
+static_assert(sizeof(MatrixHeader) == 64);
+
+/**
+ * @brief Element types of the "SPMATv2" format.
+ */
+enum ElemType : uint64_t { INT32 = 0, INT8 = 1, INT16 = 2, FLOAT = 3, DOUBLE = 4 };
+
+// Constants
+
+const char* INFILE = "inp.txt";   /// Input file
+const char* OUTFILE = "out.txt";  /// Output file
+const uint64_t HIST_BINS = 10;    /// Number of bins of histograms
+const std::string_view REDUCTIONS[] = {"zeros", "sum", "minmax", "hist", "rownnz"};  /// Names of the reductions
+
+// Global variables
+
+uint64_t N, S, K, rowInc;
+
+/**
+ * @brief Write the number of zeros counted by each thread.
+ */
+template<class T>
+void report(const sparsity::ZeroCount<T> &m, const std::vector<uint64_t> &res) {
+    std::cout << "Total number of zero-valued elements in the matrix: " << sparsity::combine(m, res) << '\n';
+    for (uint64_t i = 0; i < K; i++)
+        std::cout << "Number of zero-valued elements counted by thread" << i << ": " << res[i] << '\n';
+}
+
+/**
+ * @brief Write the sum of the elements.
+ */
+template<class T>
+void report(const sparsity::Sum<T> &m, const std::vector<typename sparsity::Sum<T>::value_type> &res) {
+    std::cout << "Sum of the nonzero elements in the matrix: " << sparsity::combine(m, res) << '\n';
+}
+
+/**
+ * @brief Write the smallest and the largest element.
+ */
+template<class T>
+void report(const sparsity::MinMax<T> &m, const std::vector<typename sparsity::MinMax<T>::value_type> &res) {
+    auto r = sparsity::combine(m, res);
+    std::cout << "Smallest element in the matrix: " << +r.min() << '\n'
+              << "Largest element in the matrix: " << +r.max() << '\n';
+}
+
+/**
+ * @brief Write the number of elements in each bin of the histogram.
+ */
+template<class T>
+void report(const sparsity::Histogram<T> &m, const std::vector<std::vector<uint64_t>> &res) {
+    auto r = sparsity::combine(m, res);
+    for (uint64_t k = 0; k < m.bins; k++)
+        std::cout << "Number of elements in bin [" << m.lo + k / m.scale << ", " << m.lo + (k + 1) / m.scale
+                  << "): " << r[k] << '\n';
+}
+
+/**
+ * @brief Write the number of nonzero elements in each row.
+ */
+template<class T>
+void report(const sparsity::RowNnz<T> &m, const std::vector<std::vector<uint64_t>> &res) {
+    auto r = sparsity::combine(m, res);
+    for (uint64_t i = 0; i < N; i++) std::cout << "Number of nonzero elements in row" << i << ": " << r[i] << '\n';
+}
+
+/**
+ * @brief Reduce a matrix with a technique and a library, and write the
+ * statistics to standard output.
+ * @param m Reduction.
+ * @param A Matrix to reduce.
+ * @param tech Name of the technique.
+ * @param lib Name of the library.
+ * @param grain Name of the grain of dynamic techniques.
+ * @param before Time spent preparing the reduction, included in the reported time.
+ * @return true on success, false if the combination is not supported.
+ */
+template<class M>
+bool reduceAndReport(const M &m, const sparsity::MatrixView<typename M::element_type> &A,
+                     const std::string &tech, const std::string &lib, const std::string &grain,
+                     std::chrono::nanoseconds before = {}) {
+    const sparsity::Entry<M> *entry = sparsity::find<M>(lib, tech, grain);
+    if (!entry) return false;
+    // Start timer
+    auto startTime = std::chrono::high_resolution_clock::now();
+    auto res = entry->reduce(m, A, K, rowInc);
+    // Finish timer
+    auto endTime = std::chrono::high_resolution_clock::now();
+    auto tm = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime + before);
+    // Collect and output statistics
+    if constexpr (std::is_same_v<M, sparsity::ZeroCount<typename M::element_type>>)
+        std::cout << "Time taken to count the number of zeros: " << tm.count() << " ms\n";
+    else
+        std::cout << "Time taken to compute the reduction " << M::name << ": " << tm.count() << " ms\n";
+    report(m, res);
+    return true;
+}
+
+/**
+ * @brief Run the reduction of the given name on a matrix.
+ * @param red Name of the reduction.
+ * @param A Matrix to reduce.
+ * @param tech Name of the technique.
+ * @param lib Name of the library.
+ * @param grain Name of the grain of dynamic techniques.
+ * @return true on success, false if the combination is not supported.
+ */
+template<class T>
+bool run(const std::string &red, const sparsity::MatrixView<T> &A, const std::string &tech, const std::string &lib,
+         const std::string &grain) {
+    using namespace sparsity;
+    if (red == ZeroCount<T>::name) return reduceAndReport(ZeroCount<T>{}, A, tech, lib, grain);
+    if (red == Sum<T>::name) return reduceAndReport(Sum<T>{}, A, tech, lib, grain);
+    if (red == MinMax<T>::name) return reduceAndReport(MinMax<T>{}, A, tech, lib, grain);
+    if (red == RowNnz<T>::name) return reduceAndReport(RowNnz<T>(A.n), A, tech, lib, grain);
+    // The bins of the histogram span the range of the elements, found with
+    // the same technique and library, and timed along with the histogram
+    const Entry<MinMax<T>> *range = find<MinMax<T>>(lib, tech, grain);
+    if (!range) return false;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    auto r = combine(MinMax<T>{}, range->reduce(MinMax<T>{}, A, K, rowInc));
+    auto rangeTime = std::chrono::high_resolution_clock::now() - startTime;
+    double lo = std::min(r.min(), r.max()), hi = std::max(r.min(), r.max());
+    return reduceAndReport(Histogram<T>(lo, hi + 1, HIST_BINS), A, tech, lib, grain, rangeTime);
+}
+
+/**
+ * @brief Function to print program help.
+ * @param name Name of executable, usually argv[0].
+ */
+void help(std::string name) {
+    std::cerr << "Usage: " << name << " [options]\n\n"
+              << "Options:\n"
+              << "  -h,--help                                         Display this information\n"
+              << "  -t,--technique {chunk|mixed|dynamic|block|steal} Use the specified technique for computation\n"
+              << "  -g,--grain     {fixed|guided|adaptive}           Claim size of the dynamic and block techniques (default: fixed)\n"
+              << "  -l,--library   {std|pthreads|omp|pool}           Use the specified library for computation\n"
+              << "  -r,--reduction {zeros|sum|minmax|hist|rownnz}    Compute the specified reduction instead of counting zeros\n"
+              << "  -b,--binary    <FILE>                            Map the binary matrix FILE of Assgn1 or Assgn2 instead of reading " << INFILE << "\n"
+              << "\nSupported combinations:";
+    for (auto &e : sparsity::TABLE<sparsity::ZeroCount<int>>) {
+        std::cerr << ' ' << e.schedule;
+        if (!e.grain.empty()) std::cerr << ':' << e.grain;
+        std::cerr << '/' << e.backend;
+    }
+    std::cerr << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    // Parse options
+    if (argc < 2) {
+        help(argv[0]);
+        return 1;
+    }
+    std::string tech = "", lib = "", red = "zeros", grain = "fixed";
+    // Binary matrix file to read from
+    const char *binFile = NULL;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            help(argv[0]);
+            return 0;
+        } else if (arg == "-t" || arg == "--technique") {
+            i++;
+            tech = argv[i];
+        } else if (arg == "-g" || arg == "--grain") {
+            i++;
+            grain = argv[i];
+        } else if (arg == "-l" || arg == "--library") {
+            i++;
+            lib = argv[i];
+        } else if (arg == "-r" || arg == "--reduction") {
+            i++;
+            red = argv[i];
+        } else if (arg == "-b" || arg == "--binary") {
+            i++;
+            binFile = argv[i];
+        } else {
+            help(argv[0]);
+            return 1;
+        }
+    }
+    if (std::find(std::begin(sparsity::GRAIN_NAMES), std::end(sparsity::GRAIN_NAMES), grain) == std::end(sparsity::GRAIN_NAMES)) {
+        std::cerr << "[ERROR] Unknown grain " << grain << std::endl;
+        return 1;
+    }
+    if (!sparsity::find<sparsity::ZeroCount<int>>(lib, tech, grain)) {
+        std::cerr << "[ERROR] Unsupported combination " << tech << '/' << lib << std::endl;
+        return 1;
+    }
+    if (std::find(std::begin(REDUCTIONS), std::end(REDUCTIONS), red) == std::end(REDUCTIONS)) {
+        std::cerr << "[ERROR] Unknown reduction " << red << std::endl;
+        return 1;
+    }
+    std::vector<int> text;
+    MatrixHeader hdr = {};
+    const char *data = NULL;
+    if (binFile) {
+        // Read inputs straight off the mapped pages
+        int fd = open(binFile, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(hdr)
+            || (data = (const char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+            std::cerr << "[ERROR] Mapping binary matrix file " << binFile << " failed: "
+                      << std::strerror(errno ? errno : EINVAL) << std::endl;
+            return 1;
+        }
+        close(fd);
+        std::memcpy(&hdr, data, sizeof(hdr));
+        if (!std::memcmp(hdr.magic, "SPMATv1", 8)) hdr.stride = hdr.N, hdr.type = INT32;
+        else if (std::memcmp(hdr.magic, "SPMATv2", 8)) hdr.stride = 0;
+        static const uint64_t SIZES[] = {4, 1, 2, 4, 8};
+        if (hdr.stride < hdr.N || hdr.type > DOUBLE
+            || (uint64_t)st.st_size < sizeof(hdr) + hdr.N * hdr.stride * SIZES[hdr.type]) {
+            std::cerr << "[ERROR] Mapping binary matrix file " << binFile << " failed: "
+                      << std::strerror(EINVAL) << std::endl;
+            return 1;
+        }
+        N = hdr.N, S = hdr.S, K = hdr.K, rowInc = hdr.rowInc;
+        data += sizeof(hdr);
+    } else {
+        if (!freopen(INFILE, "r", stdin)) {
+            std::cerr << "[ERROR] Opening input file " << INFILE << " failed: "
+                      << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        // Read inputs
+        std::cin.tie(0)->sync_with_stdio(0);
+        std::cin >> N >> S >> K >> rowInc;
+        text.resize(N * N);
+        for (int &v : text) std::cin >> v;
+        hdr.stride = N, hdr.type = INT32;
+        data = (const char *)text.data();
+    }
+    if (!freopen(OUTFILE, "w", stdout)) {
+        std::cerr << "[ERROR] Opening output file " << OUTFILE << " failed: "
+                  << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    bool ok = false;
+    switch (hdr.type) {
+        case INT32: ok = run<int>(red, {(const int *)data, N, hdr.stride}, tech, lib, grain); break;
+        case INT8: ok = run<int8_t>(red, {(const int8_t *)data, N, hdr.stride}, tech, lib, grain); break;
+        case INT16: ok = run<int16_t>(red, {(const int16_t *)data, N, hdr.stride}, tech, lib, grain); break;
+        case FLOAT: ok = run<float>(red, {(const float *)data, N, hdr.stride}, tech, lib, grain); break;
+        case DOUBLE: ok = run<double>(red, {(const double *)data, N, hdr.stride}, tech, lib, grain); break;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,295 @@
+/**
+ * @author Gautam Singh (CS21BTECH11018)
+ * @file suite.cpp
+ * @brief In-process benchmark suite of the zero count, running the four
+ * experiments of Assgn1/run.py and Assgn2/run.py without recompiling or
+ * respawning anything. Matrices are generated once per size and sparsity and
+ * reused, every configuration is warmed up before it is timed in nanoseconds,
+ * and the median of the runs is reported with a confidence interval. Results
+ * can be stored as a baseline, and later runs checked against it for
+ * regressions.
+ *
+ * @date 2026-10-17
+ */
+
+// Headers
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <cstring>
+#include "engine.hpp"
+
+// Classes and structs
+
+/**
+ * @brief One configuration of an experiment.
+ */
+struct Config {
+    std::string exp;            /// Name of the experiment
+    uint64_t N, S, K, rowInc;   /// Parameters of the input file
+    std::string tech, lib;      /// Technique and library
+
+    /**
+     * @brief Key of the configuration in baseline files.
+     */
+    std::string key() const {
+        std::ostringstream os;
+        os << exp << ' ' << N << ' ' << S << ' ' << K << ' ' << rowInc << ' ' << tech << ' ' << lib;
+        return os.str();
+    }
+};
+
+/**
+ * @brief Timing of a configuration: the median of its runs, and a confidence
+ * interval of the median.
+ */
+struct Timing {
+    double median;  /// Median time in nanoseconds
+    double lo;      /// Lower end of the confidence interval
+    double hi;      /// Upper end of the confidence interval
+};
+
+// Constants
+
+/// @brief Parameters of the experiments of run.py
+const std::vector<uint64_t> SIZES = {1000, 2000, 3000, 4000, 5000};
+const std::vector<uint64_t> THREADS = {1, 2, 4, 8, 16, 32};
+const std::vector<uint64_t> SPARSITIES = {20, 40, 60, 80};
+const std::vector<uint64_t> ROW_INCREMENTS = {10, 20, 30, 40, 50};
+/// @brief Standard normal quantile of a two-sided 95% confidence interval
+const double Z95 = 1.96;
+
+// Global variables
+
+uint64_t WARMUP = 2, RUNS = 15, MAX_SIZE = 5000;
+double TOLERANCE = 0.05;
+/// @brief Generated matrices, by size and sparsity
+std::map<std::pair<uint64_t, uint64_t>, std::vector<int>> matrices;
+
+/**
+ * @brief Generate a matrix once, and reuse it for every later configuration
+ * with the same size and sparsity.
+ * @param N Number of rows (and columns).
+ * @param S Sparsity in percent.
+ * @return View of the matrix.
+ */
+sparsity::MatrixView<int> matrix(uint64_t N, uint64_t S) {
+    std::vector<int> &m = matrices[{N, S}];
+    if (m.empty()) {
+        std::mt19937_64 gen(N * 100 + S);
+        std::uniform_int_distribution<int> val(1, 9), pct(0, 99);
+        m.resize(N * N);
+        for (int &v : m) v = (uint64_t)pct(gen) < S ? 0 : val(gen);
+    }
+    return {m.data(), N, N};
+}
+
+/**
+ * @brief Time a configuration. The confidence interval of the median is
+ * distribution-free, taken between the order statistics that bracket the
+ * median with 95% probability.
+ * @param c Configuration.
+ * @return Timing of the configuration.
+ */
+Timing measure(const Config &c) {
+    sparsity::MatrixView<int> A = matrix(c.N, c.S);
+    auto count = sparsity::find<sparsity::ZeroCount<int>>(c.lib, c.tech)->reduce;
+    std::vector<double> times;
+    for (uint64_t r = 0; r < WARMUP + RUNS; r++) {
+        auto startTime = std::chrono::steady_clock::now();
+        auto res = count({}, A, c.K, c.rowInc);
+        auto endTime = std::chrono::steady_clock::now();
+        asm volatile("" : : "r"(res.data()) : "memory");
+        if (r >= WARMUP) times.push_back(std::chrono::duration<double, std::nano>(endTime - startTime).count());
+    }
+    std::sort(times.begin(), times.end());
+    uint64_t n = times.size();
+    double half = Z95 * std::sqrt((double)n) / 2;
+    uint64_t lo = (uint64_t)std::max(0.0, std::floor(n / 2.0 - half));
+    uint64_t hi = std::min<uint64_t>(n - 1, (uint64_t)std::ceil(n / 2.0 + half));
+    double median = n % 2 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+    return {median, times[lo], times[hi]};
+}
+
+/**
+ * @brief List the configurations of the experiments of run.py, with every
+ * technique of the given libraries, with the fixed grain of run.py. Experiment
+ * 4 varies the row increment, so it only runs the techniques that claim rows
+ * dynamically.
+ * @param exps Names of the experiments to run.
+ * @param libs Names of the libraries to run.
+ * @return Configurations to time.
+ */
+std::vector<Config> configs(const std::vector<std::string> &exps, const std::vector<std::string> &libs) {
+    std::vector<std::tuple<std::string, uint64_t, uint64_t, uint64_t, uint64_t>> params;
+    auto want = [&](const char *e) { return std::find(exps.begin(), exps.end(), e) != exps.end(); };
+    if (want("exp1")) for (uint64_t N : SIZES) params.emplace_back("exp1", N, 40, 16, 50);
+    if (want("exp2")) for (uint64_t K : THREADS) params.emplace_back("exp2", 5000, 40, K, 50);
+    if (want("exp3")) for (uint64_t S : SPARSITIES) params.emplace_back("exp3", 5000, S, 16, 50);
+    if (want("exp4")) for (uint64_t r : ROW_INCREMENTS) params.emplace_back("exp4", 5000, 40, 16, r);
+    std::vector<Config> res;
+    for (auto &[exp, N, S, K, rowInc] : params) {
+        if (N > MAX_SIZE) continue;
+        for (auto &lib : libs)
+            for (auto &e : sparsity::TABLE<sparsity::ZeroCount<int>>) {
+                if (e.backend != lib || (!e.grain.empty() && e.grain != "fixed")) continue;
+                if (exp == "exp4" && e.schedule != "dynamic" && e.schedule != "block") continue;
+                res.push_back({exp, N, S, K, rowInc, std::string(e.schedule), lib});
+            }
+    }
+    return res;
+}
+
+/**
+ * @brief Read a baseline file.
+ * @param file Path of the baseline file.
+ * @param baseline Populated with the timing of each configuration.
+ * @return true on success, false (with errno set) on failure.
+ */
+bool readBaseline(const char *file, std::map<std::string, Timing> &baseline) {
+    std::ifstream in(file);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream is(line);
+        std::string exp, tech, lib;
+        uint64_t N, S, K, rowInc;
+        Timing t;
+        if (!(is >> exp >> N >> S >> K >> rowInc >> tech >> lib >> t.median >> t.lo >> t.hi)) {
+            errno = EINVAL;
+            return false;
+        }
+        baseline[Config{exp, N, S, K, rowInc, tech, lib}.key()] = t;
+    }
+    return true;
+}
+
+/**
+ * @brief Split a comma-separated list.
+ * @param s List to split.
+ * @return Items of the list.
+ */
+std::vector<std::string> split(const std::string &s) {
+    std::vector<std::string> res;
+    std::istringstream is(s);
+    for (std::string item; std::getline(is, item, ',');) res.push_back(item);
+    return res;
+}
+
+/**
+ * @brief Function to print program help.
+ * @param name Name of executable, usually argv[0].
+ */
+void help(std::string name) {
+    std::cerr << "Usage: " << name << " [options]\n\n"
+              << "Options:\n"
+              << "  -h,--help                        Display this information\n"
+              << "  -e,--experiments <LIST>          Run the comma-separated experiments of run.py (default: exp1,exp2,exp3,exp4)\n"
+              << "  -l,--libraries   <LIST>          Run every technique of the comma-separated libraries (default: std,pthreads,omp)\n"
+              << "  -w,--warmup      <W>             Discard the first W runs of every configuration (default: " << WARMUP << ")\n"
+              << "  -r,--runs        <R>             Time R runs of every configuration (default: " << RUNS << ")\n"
+              << "  -m,--max-size    <N>             Skip matrices with more than N rows (default: " << MAX_SIZE << ")\n"
+              << "  -s,--save        <FILE>          Store the timings as the baseline FILE\n"
+              << "  -b,--baseline    <FILE>          Check the timings for regressions against the baseline FILE\n"
+              << "  -x,--tolerance   <PCT>           Only report regressions slower by more than PCT percent (default: "
+              << TOLERANCE * 100 << ")\n";
+}
+
+int main(int argc, char* argv[]) {
+    // Parse options
+    std::vector<std::string> exps = {"exp1", "exp2", "exp3", "exp4"}, libs = {"std", "pthreads", "omp"};
+    const char *saveFile = NULL, *baseFile = NULL;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            help(argv[0]);
+            return 0;
+        } else if (i + 1 == argc) {
+            help(argv[0]);
+            return 1;
+        } else if (arg == "-e" || arg == "--experiments") {
+            exps = split(argv[++i]);
+        } else if (arg == "-l" || arg == "--libraries") {
+            libs = split(argv[++i]);
+        } else if (arg == "-w" || arg == "--warmup") {
+            WARMUP = std::stoull(argv[++i]);
+        } else if (arg == "-r" || arg == "--runs") {
+            RUNS = std::max<uint64_t>(std::stoull(argv[++i]), 1);
+        } else if (arg == "-m" || arg == "--max-size") {
+            MAX_SIZE = std::stoull(argv[++i]);
+        } else if (arg == "-s" || arg == "--save") {
+            saveFile = argv[++i];
+        } else if (arg == "-b" || arg == "--baseline") {
+            baseFile = argv[++i];
+        } else if (arg == "-x" || arg == "--tolerance") {
+            TOLERANCE = std::stod(argv[++i]) / 100;
+        } else {
+            help(argv[0]);
+            return 1;
+        }
+    }
+    for (auto &lib : libs) {
+        if (!sparsity::find<sparsity::ZeroCount<int>>(lib, "chunk")) {
+            std::cerr << "[ERROR] Unsupported library " << lib << std::endl;
+            return 1;
+        }
+    }
+    std::map<std::string, Timing> baseline;
+    if (baseFile && !readBaseline(baseFile, baseline)) {
+        std::cerr << "[ERROR] Reading baseline file " << baseFile << " failed: "
+                  << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::ofstream save;
+    if (saveFile) {
+        save.open(saveFile);
+        save << std::fixed << std::setprecision(0);
+        if (!save) {
+            std::cerr << "[ERROR] Opening baseline file " << saveFile << " failed: "
+                      << std::strerror(errno) << std::endl;
+            return 1;
+        }
+    }
+    // Time every configuration
+    uint64_t regressions = 0;
+    std::cout << std::left << std::setw(40) << "exp N S K rowInc technique library"
+              << std::right << std::setw(14) << "median (ms)" << std::setw(26) << "95% CI (ms)" << '\n'
+              << std::fixed << std::setprecision(3);
+    for (const Config &c : configs(exps, libs)) {
+        Timing t = measure(c);
+        std::string key = c.key();
+        std::cout << std::left << std::setw(40) << key << std::right << std::setw(14) << t.median / 1e6
+                  << std::setw(12) << t.lo / 1e6 << " - " << std::setw(11) << t.hi / 1e6;
+        auto it = baseline.find(key);
+        if (it != baseline.end()) {
+            const Timing &b = it->second;
+            double change = t.median / b.median - 1;
+            // Regressed only if the intervals are apart and the medians further than the tolerance
+            bool regressed = t.lo > b.hi && change > TOLERANCE;
+            std::cout << std::showpos << std::setw(10) << change * 100 << "%" << std::noshowpos
+                      << (regressed ? "  REGRESSION" : "");
+            regressions += regressed;
+        }
+        std::cout << std::endl;
+        if (saveFile) save << key << ' ' << t.median << ' ' << t.lo << ' ' << t.hi << '\n';
+    }
+    if (saveFile && !save.flush()) {
+        std::cerr << "[ERROR] Writing baseline file " << saveFile << " failed: "
+                  << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    if (regressions) {
+        std::cerr << "[ERROR] " << regressions << " configurations regressed against baseline " << baseFile << std::endl;
+        return 1;
+    }
+    return 0;
+}